@@ -25,49 +25,99 @@ THE SOFTWARE.
 
 #include "ext/prof_protocol.h"
 
+#include <atomic>
 #include <mutex>
 
 namespace roctracer {
 
 // Generic callbacks table
+// The (callback, arg) pairs are immutable entries published by atomic pointers, so the
+// lookup on the API call is one acquire load. The entries are interned and never freed,
+// also by the table destruction as the static tables are destroyed at exit while the API
+// calls may still be running, so an entry read by a concurrent call stays valid and
+// re-registering the same pair reuses its entry.
+// The enabled ops bitmap lets the generated wrappers skip the disabled calls.
 template <int N>
 class CbTable {
   public:
   typedef std::mutex mutex_t;
 
-  CbTable() {
+  static const uint32_t WORD_BITS = 64;
+  static const uint32_t WORD_COUNT = (N + WORD_BITS - 1) / WORD_BITS;
+
+  CbTable() : entries_(NULL) {
     std::lock_guard<mutex_t> lck(mutex_);
-    for (int i = 0; i < N; i++) {
-      callback_[i] = NULL;
-      arg_[i] = NULL;
-    }
+    for (int i = 0; i < N; i++) entry_[i].store(NULL, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < WORD_COUNT; i++) enabled_[i].store(0, std::memory_order_relaxed);
+  }
+
+  ~CbTable() {
+    std::lock_guard<mutex_t> lck(mutex_);
+    for (int i = 0; i < N; i++) entry_[i].store(NULL, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < WORD_COUNT; i++) enabled_[i].store(0, std::memory_order_relaxed);
   }
 
   bool set(uint32_t id, activity_rtapi_callback_t callback, void* arg) {
     std::lock_guard<mutex_t> lck(mutex_);
     bool ret = false;
     if (id < N) {
-      callback_[id] = callback;
-      arg_[id] = arg;
+      entry_[id].store((callback != NULL) ? intern(callback, arg) : NULL, std::memory_order_release);
+      const uint64_t bit = 1ULL << (id % WORD_BITS);
+      if (callback != NULL) enabled_[id / WORD_BITS].fetch_or(bit, std::memory_order_release);
+      else enabled_[id / WORD_BITS].fetch_and(~bit, std::memory_order_release);
       ret = true;
     }
     return ret;
   }
 
-  bool get(uint32_t id, activity_rtapi_callback_t* callback, void** arg) {
+  // Setting the callback for all ops, one entry is interned for the whole table
+  void set_all(activity_rtapi_callback_t callback, void* arg) {
     std::lock_guard<mutex_t> lck(mutex_);
+    const entry_t* entry = (callback != NULL) ? intern(callback, arg) : NULL;
+    for (int i = 0; i < N; i++) entry_[i].store(entry, std::memory_order_release);
+    for (uint32_t i = 0; i < WORD_COUNT; i++) {
+      const uint32_t bits = ((i + 1) * WORD_BITS <= (uint32_t)N) ? WORD_BITS : (N % WORD_BITS);
+      const uint64_t mask = (bits == WORD_BITS) ? ~0ULL : ((1ULL << bits) - 1);
+      enabled_[i].store((entry != NULL) ? mask : 0, std::memory_order_release);
+    }
+  }
+
+  // The op has a callback registered, get() may still return NULL if it is unset concurrently
+  bool enabled(uint32_t id) const {
+    return (id < N) && ((enabled_[id / WORD_BITS].load(std::memory_order_relaxed) >> (id % WORD_BITS)) & 1);
+  }
+
+  bool get(uint32_t id, activity_rtapi_callback_t* callback, void** arg) {
     bool ret = false;
     if (id < N) {
-      *callback = callback_[id];
-      *arg = arg_[id];
+      const entry_t* entry = entry_[id].load(std::memory_order_acquire);
+      *callback = (entry != NULL) ? entry->callback : NULL;
+      *arg = (entry != NULL) ? entry->arg : NULL;
       ret = true;
     }
     return ret;
   }
 
   private:
-  activity_rtapi_callback_t callback_[N];
-  void* arg_[N];
+  struct entry_t {
+    activity_rtapi_callback_t callback;
+    void* arg;
+    entry_t* next;
+  };
+
+  entry_t* intern(activity_rtapi_callback_t callback, void* arg) {
+    for (entry_t* entry = entries_; entry != NULL; entry = entry->next) {
+      if ((entry->callback == callback) && (entry->arg == arg)) return entry;
+    }
+    entry_t* entry = new entry_t{callback, arg, entries_};
+    entries_ = entry;
+    return entry;
+  }
+
+  std::atomic<const entry_t*> entry_[N];
+  std::atomic<uint64_t> enabled_[WORD_COUNT];
+  // Interned entries list, guarded by the mutex
+  entry_t* entries_;
   mutex_t mutex_;
 };
 
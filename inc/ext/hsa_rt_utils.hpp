@@ -42,6 +42,79 @@ THE SOFTWARE.
 
 namespace hsa_rt_utils {
 
+// System clock ticks to ns converter.
+// The ns per tick ratio is split into the integer part and the 64-bit binary fraction,
+// ns = ticks * int + (ticks * frac) >> 64. The fraction is rounded down by less than
+// 2^-64 ns per tick, so for any 64-bit ticks value the result is the exact value
+// rounded down or less by one, the error is below 1 ns.
+// The batch conversion is vectorizable for the integer ratios (frac is zero).
+// The 128-bit arithmetic is emulated where the compiler has no 128-bit integer type.
+class TimestampConverter {
+  public:
+  typedef uint64_t timestamp_t;
+
+  TimestampConverter() : int_(0), frac_(0) {}
+
+  void init(const timestamp_t& hz) {
+    const timestamp_t ns_per_sec = 1000000000;
+    int_ = ns_per_sec / hz;
+    frac_ = div_frac(ns_per_sec % hz, hz);
+  }
+
+  timestamp_t to_ns(const timestamp_t& ticks) const {
+    return ticks * int_ + mul_hi(ticks, frac_);
+  }
+
+  // Batch conversion, the input and output arrays can be the same
+  void to_ns(const timestamp_t* ticks, timestamp_t* ns, const size_t& count) const {
+    const timestamp_t mult = int_;
+    if (frac_ == 0) {
+      for (size_t i = 0; i < count; ++i) ns[i] = ticks[i] * mult;
+    } else {
+      for (size_t i = 0; i < count; ++i) ns[i] = to_ns(ticks[i]);
+    }
+  }
+
+  private:
+  // (num << 64) / den, num is less than den
+  static timestamp_t div_frac(const timestamp_t& num, const timestamp_t& den) {
+#if defined(__SIZEOF_INT128__)
+    return (timestamp_t)(((unsigned __int128)num << 64) / den);
+#else
+    timestamp_t rem = num;
+    timestamp_t frac = 0;
+    for (unsigned i = 0; i < 64; ++i) {
+      const bool carry = (rem >> 63) != 0;
+      rem <<= 1;
+      frac <<= 1;
+      if (carry || (rem >= den)) {
+        rem -= den;
+        frac |= 1;
+      }
+    }
+    return frac;
+#endif
+  }
+
+  // High 64 bits of the 128-bit product
+  static timestamp_t mul_hi(const timestamp_t& a, const timestamp_t& b) {
+#if defined(__SIZEOF_INT128__)
+    return (timestamp_t)(((unsigned __int128)a * b) >> 64);
+#else
+    const timestamp_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+    const timestamp_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+    const timestamp_t lo_lo = a_lo * b_lo;
+    const timestamp_t hi_lo = a_hi * b_lo;
+    const timestamp_t lo_hi = a_lo * b_hi;
+    const timestamp_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+  }
+
+  timestamp_t int_;
+  timestamp_t frac_;
+};
+
 // HSA runtime timer implementation
 class Timer {
   public:
@@ -58,6 +131,7 @@ class Timer {
     } else {
       HSART_CALL(get_info_fn(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &timestamp_hz));
       timestamp_rate_ = (freq_t)1000000000 / (freq_t)timestamp_hz;
+      converter_.init(timestamp_hz);
     }
   }
 
@@ -66,7 +140,10 @@ class Timer {
 
   // Convert a given timestamp to ns
   timestamp_t timestamp_to_ns(const timestamp_t &timestamp) const {
-    return timestamp_t((freq_t)timestamp * timestamp_rate_);
+    return converter_.to_ns(timestamp);
+  }
+  void timestamp_to_ns(const timestamp_t* timestamp, timestamp_t* ns, const size_t& count) const {
+    converter_.to_ns(timestamp, ns, count);
   }
 
   // Return timestamp in 'ns'
@@ -91,6 +168,8 @@ class Timer {
   hsa_system_get_info_fn_t hsa_system_get_info_fn;
   // Timestamp rate
   freq_t timestamp_rate_;
+  // Timestamp to ns converter
+  TimestampConverter converter_;
 };
 
 class TimerFactory {
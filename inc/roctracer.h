@@ -145,28 +145,125 @@ static inline int roctracer_next_record(
   return ROCTRACER_STATUS_SUCCESS;
 }
 
+// Framed record types
+typedef enum {
+  ROCTRACER_RECORD_TYPE_ACTIVITY = 0,                     // activity record with optional inline payload
+  ROCTRACER_RECORD_TYPE_PAD = 1,                          // padding, file-backed pools only
+} roctracer_record_type_t;
+
+// Framed record header
+// The records of the pools in ROCTRACER_POOL_MODE_VAR_RECORDS mode are framed,
+// the header is followed by the activity record and the inline payload
+typedef struct {
+    uint32_t size;                                        // framed record size including the header
+    uint32_t type;                                        // record type, roctracer_record_type_t
+    uint32_t payload_size;                                // inline payload size
+    uint32_t reserved;
+} roctracer_record_header_t;
+
+// Return framed record activity record
+static inline const activity_record_t* roctracer_record_data(
+    const roctracer_record_header_t* header)              // [in] framed record header
+{
+  return (const activity_record_t*)(header + 1);
+}
+
+// Return framed record inline payload, NULL if there is no payload
+static inline const void* roctracer_record_payload(
+    const roctracer_record_header_t* header)              // [in] framed record header
+{
+  return (header->payload_size != 0) ? (const char*)(header + 1) + sizeof(activity_record_t) : NULL;
+}
+
+// Return next framed record
+static inline int roctracer_next_var_record(
+    const roctracer_record_header_t* header,              // [in] framed record header
+    const roctracer_record_header_t** next)               // [out] next framed record header
+{
+  *next = (const roctracer_record_header_t*)((const char*)header + header->size);
+  return ROCTRACER_STATUS_SUCCESS;
+}
+
 // Tracer allocator type
 typedef void (*roctracer_allocator_t)(
     char** ptr,                                           // memory pointer
     size_t size,                                          // memory size
     void* arg);                                           // allocator arg
 
+// Built-in huge pages allocator, can be used as the pool allocator function
+// The memory is mapped with huge pages, transparent ones if no huge pages are reserved,
+// and is placed on the NUMA node of the pool opening thread.
+// Setting ROCTRACER_HUGE_PAGES=1 makes it the default pool allocator.
+void roctracer_huge_page_allocator(
+    char** ptr,                                           // memory pointer
+    size_t size,                                          // memory size
+    void* arg);                                           // allocator arg
+
 // Pool callback type
 typedef void (*roctracer_buffer_callback_t)(
     const char* begin,                                    // [in] available buffered trace records
     const char* end,                                      // [in] end of buffered trace records
     void* arg);                                           // [in/out] callback arg
 
+// Tracer pool mode flags
+typedef enum {
+  ROCTRACER_POOL_MODE_DEFAULT = 0x0,                      // records written under the pool lock
+  ROCTRACER_POOL_MODE_THREAD_CHUNKS = 0x1,                // lock-free writes to per-thread chunks,
+                                                          // buffer callback is called per chunk
+  // Back-pressure policy if all pool buffers are pending
+  ROCTRACER_POOL_MODE_BLOCK = 0x0,                        // producers wait for a free buffer
+  ROCTRACER_POOL_MODE_DROP_NEWEST = 0x2,                  // new records are dropped
+  ROCTRACER_POOL_MODE_OVERWRITE_OLDEST = 0x4,             // the oldest not yet read buffer is overwritten
+  ROCTRACER_POOL_MODE_POLICY_MASK = 0x6,
+  ROCTRACER_POOL_MODE_FLIGHT_RECORDER = 0x8,              // the pool is a ring of the latest records overwriting
+                                                          // the oldest ones, the buffer callback is called only
+                                                          // on flush, on the dump signal or on the trigger
+  ROCTRACER_POOL_MODE_VAR_RECORDS = 0x10,                 // records are framed by roctracer_record_header_t
+                                                          // and can carry inline payload
+  ROCTRACER_POOL_MODE_FILE = 0x20,                        // pool buffers are mapped to the output file,
+                                                          // the records are framed, the callback is optional
+} roctracer_pool_mode_t;
+
+// Flight recorder trigger predicate type, returning true triggers the pool dump
+typedef bool (*roctracer_trigger_callback_t)(
+    const activity_record_t* record,                      // [in] written record
+    void* arg);                                           // [in/out] predicate arg
+
 // Tracer properties
 typedef struct {
-    uint32_t mode;                                        // roctracer mode
+    uint32_t mode;                                        // roctracer mode, roctracer_pool_mode_t flags
     size_t buffer_size;                                   // buffer size
     roctracer_allocator_t alloc_fun;                      // memory alocator function pointer
     void* alloc_arg;                                      // memory alocator function pointer
     roctracer_buffer_callback_t buffer_callback_fun;      // tracer record callback function
     void* buffer_callback_arg;                            // tracer record callback arg
+    uint32_t buffer_count;                                // number of pool buffers, 0 is default(2)
+    roctracer_trigger_callback_t trigger_fun;             // flight recorder trigger predicate, NULL is none
+    void* trigger_arg;                                    // flight recorder trigger predicate arg
+    int dump_signal;                                      // flight recorder dump signal number, 0 is none
+    uint32_t drain_timeout;                               // pool close drain timeout in ms, 0 is polling, UINT32_MAX is infinite
+    const char* file_name;                                // file-backed pool output file
 } roctracer_properties_t;
 
+// File-backed pool file header
+// The header is followed by the file buffers of framed records, the buffers are committed
+// to the file in order and the tail of a buffer is filled by a padding record
+#define ROCTRACER_POOL_FILE_MAGIC 0x4c4f4f5052544352ULL  // "RCTRPOOL"
+#define ROCTRACER_POOL_FILE_VERSION 1
+typedef struct {
+    uint64_t magic;                                       // ROCTRACER_POOL_FILE_MAGIC
+    uint32_t version;                                     // ROCTRACER_POOL_FILE_VERSION
+    uint32_t header_size;                                 // file offset of the first buffer
+    uint64_t buffer_size;                                 // file buffer size
+    uint64_t committed_size;                              // size of the committed buffers
+} roctracer_pool_file_header_t;
+
+// Tracer pool statistics
+typedef struct {
+    uint64_t buffer_wait_count;                           // producers waited for a free buffer
+    uint64_t dropped_record_count;                        // records dropped or overwritten
+} roctracer_pool_stats_t;
+
 // Tracer memory pool type
 typedef void roctracer_pool_t;
 
@@ -187,6 +284,19 @@ roctracer_status_t roctracer_close_pool(
 roctracer_pool_t* roctracer_default_pool(
     roctracer_pool_t* pool = NULL);                       // [in] new default pool if not NULL
 
+// Write activity record to the pool, the payload is copied inline
+// Non empty payload requires the pool in ROCTRACER_POOL_MODE_VAR_RECORDS mode
+roctracer_status_t roctracer_write_record(
+    const activity_record_t* record,                      // [in] activity record
+    const void* payload,                                  // [in] payload
+    uint32_t payload_size,                                // payload size
+    roctracer_pool_t* pool = NULL);                       // [in] memory pool, NULL is a default one
+
+// Return tracer memory pool statistics
+roctracer_status_t roctracer_get_pool_stats(
+    roctracer_pool_stats_t* stats,                        // [out] pool statistics
+    roctracer_pool_t* pool = NULL);                       // [in] memory pool, NULL is a default one
+
 // Enable activity records logging
 roctracer_status_t roctracer_enable_op_activity(
     activity_domain_t domain,                             // tracing domain
@@ -210,6 +320,23 @@ roctracer_status_t roctracer_disable_activity();
 roctracer_status_t roctracer_flush_activity(
     roctracer_pool_t* pool = NULL);                       // memory pool, NULL is a default one
 
+// Flush completion handle
+typedef struct {
+    roctracer_pool_t* pool;                               // flushed memory pool
+    uint64_t index;                                       // pool flush completion index
+} roctracer_flush_handle_t;
+
+// Start flushing available activity records without waiting for the buffer callbacks
+roctracer_status_t roctracer_flush_activity_async(
+    roctracer_flush_handle_t* handle,                     // [out] flush completion handle
+    roctracer_pool_t* pool = NULL);                       // memory pool, NULL is a default one
+
+// Wait for the flush completion
+// ROCTRACER_STATUS_BREAK is returned if the flush is not completed in the timeout
+roctracer_status_t roctracer_flush_wait(
+    const roctracer_flush_handle_t* handle,               // [in] flush completion handle
+    uint32_t timeout);                                    // timeout in ms, 0 is polling, UINT32_MAX is infinite
+
 // Load/Unload methods
 // Set properties
 roctracer_status_t roctracer_set_properties(
@@ -77,6 +77,12 @@ bool RegisterApiCallback(uint32_t op, void* callback, void* arg);
 // Remove ROCTX callback for given opertaion id
 bool RemoveApiCallback(uint32_t op);
 
+// Register ROCTX callback for all operations
+bool RegisterApiCallbackAll(void* callback, void* arg);
+
+// Remove ROCTX callback for all operations
+bool RemoveApiCallbackAll();
+
 // Iterate range stack to support tracing start/stop
 typedef struct {
   const char* message;
@@ -377,6 +377,7 @@ class API_DescrParser:
       call_id = self.api_id[call];
       ret_type = struct['ret']
       self.content += 'static ' + ret_type + ' ' + call + '_callback(' + struct['args'] + ') {\n'
+      self.content += '  if (!cb_table.enabled(' + call_id + ')) return ' + name + '_saved.' + call + '_fn(' + ', '.join(struct['alst']) + ');\n'
       self.content += '  hsa_api_data_t api_data{};\n'
       for var in struct['alst']:
         item = struct['astr'][var];
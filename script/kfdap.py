@@ -403,6 +403,8 @@ class API_DescrParser:
       self.content_h += ret_type + ' ' + call + '_callback(' + struct['args'] + ') {\n'  # 'static '  + 
       if call == 'hsaKmtOpenKFD':
         self.content_h += '  if (' + name + '_table == NULL) intercept_KFDApiTable();\n'
+      tmp_str = '  if (!cb_table.enabled(' + call_id + ')) return ' + name + '_table->' + call + '_fn(' + ', '.join(struct['alst']) + ');\n'
+      self.content_h += tmp_str.replace("[]","")
       self.content_h += '  kfd_api_data_t api_data{};\n'
       for var in struct['alst']:
         self.content_h += '  api_data.args.' + call + '.' + var.replace("[]","") + ' = ' + var.replace("[]","") + ';\n'
@@ -518,6 +520,14 @@ class API_DescrParser:
       self.content_cpp += 'PUBLIC_API bool RemoveApiCallback(uint32_t op) {\n'
       self.content_cpp += '    roctracer::kfd_support::cb_table.set(op, NULL, NULL);\n';
       self.content_cpp += '    return true;\n';
+      self.content_cpp += '}\n';
+      self.content_cpp += 'PUBLIC_API bool RegisterApiCallbackAll(void* callback, void* user_data) {\n';
+      self.content_cpp += '    roctracer::kfd_support::cb_table.set_all(reinterpret_cast<activity_rtapi_callback_t>(callback), user_data);\n';
+      self.content_cpp += '    return true;\n';
+      self.content_cpp += '}\n';
+      self.content_cpp += 'PUBLIC_API bool RemoveApiCallbackAll() {\n'
+      self.content_cpp += '    roctracer::kfd_support::cb_table.set_all(NULL, NULL);\n';
+      self.content_cpp += '    return true;\n';
       self.content_cpp += '}\n\n';
 
     if call != '-':
@@ -0,0 +1,276 @@
+#ifndef SRC_CORE_CHUNK_POOL_H_
+#define SRC_CORE_CHUNK_POOL_H_
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "util/huge_page_allocator.h"
+
+#define PTHREAD_CALL(call)                                                                         \
+  do {                                                                                             \
+    int err = call;                                                                                \
+    if (err != 0) {                                                                                \
+      errno = err;                                                                                 \
+      perror(#call);                                                                               \
+      abort();                                                                                     \
+    }                                                                                              \
+  } while (0)
+
+namespace roctracer {
+// Process-wide pool of the preallocated trace buffer chunks.
+// The chunks of the same size, memory kind and reset function form a class and are kept
+// in a bounded lock-free queue. One shared worker thread refills a class up to the high
+// watermark when the number of its free chunks drops below the low watermark, the pool
+// is not filled before the first refilling acquire. The chunks are anonymous mappings,
+// zeroed and not touched until written, a released chunk is reset by the class reset
+// function. The chunks are released consumed, all their entries were written.
+// The watermarks can be set by ROCTRACER_CHUNK_POOL_LOW/ROCTRACER_CHUNK_POOL_HIGH.
+class ChunkPool {
+ public:
+  typedef void (*reset_fun_t)(void* ptr, size_t size);
+
+  static const uint32_t CLASSES_MAX = 16;
+  static const uint32_t QUEUE_SIZE_MAX = 64;
+  static const uint32_t LOW_WATERMARK = 1;
+  static const uint32_t HIGH_WATERMARK = 2;
+
+  static ChunkPool* Instance() {
+    static ChunkPool instance;
+    return &instance;
+  }
+
+  uint32_t Register(size_t size, bool huge_pages, reset_fun_t reset_fun) {
+    std::lock_guard<std::mutex> lck(ctl_mutex_);
+    const uint32_t count = class_count_.load(std::memory_order_relaxed);
+    uint32_t index = 0;
+    for (; index < count; ++index) {
+      const class_t& cls = class_arr_[index];
+      if ((cls.size == size) && (cls.huge_pages == huge_pages) && (cls.reset_fun == reset_fun)) break;
+    }
+    if (index == count) {
+      if (count == CLASSES_MAX) abort_run("ChunkPool::Register: too many chunk classes");
+      class_t& cls = class_arr_[index];
+      cls.size = size;
+      cls.huge_pages = huge_pages;
+      cls.reset_fun = reset_fun;
+      cls.refs = 0;
+      cls.enqueue_pos.store(0, std::memory_order_relaxed);
+      cls.dequeue_pos.store(0, std::memory_order_relaxed);
+      for (uint32_t i = 0; i < high_; ++i) cls.cell_arr[i].seq.store(i, std::memory_order_relaxed);
+      class_count_.store(count + 1, std::memory_order_release);
+    }
+    class_arr_[index].refs += 1;
+
+    if (refs_ == 0) {
+      stop_ = false;
+      PTHREAD_CALL(pthread_create(&work_thread_, NULL, refill_worker, this));
+    }
+    refs_ += 1;
+    return index;
+  }
+
+  void Unregister(uint32_t index) {
+    std::lock_guard<std::mutex> lck(ctl_mutex_);
+    class_arr_[index].refs -= 1;
+    refs_ -= 1;
+    if (refs_ != 0) return;
+
+    // The last user is gone, stopping the worker and freeing the pooled chunks
+    PTHREAD_CALL(pthread_mutex_lock(&work_mutex_));
+    stop_ = true;
+    PTHREAD_CALL(pthread_cond_signal(&work_cond_));
+    PTHREAD_CALL(pthread_mutex_unlock(&work_mutex_));
+    PTHREAD_CALL(pthread_join(work_thread_, NULL));
+
+    const uint32_t count = class_count_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+      class_t& cls = class_arr_[i];
+      while (void* ptr = pop(cls)) free_chunk(cls, ptr);
+    }
+    class_count_.store(0, std::memory_order_relaxed);
+  }
+
+  // Returns a zeroed or reset chunk, allocates it synchronously if the class is exhausted.
+  // The class is refilled if 'refill' is set, the first chunk of a buffer is acquired
+  // without, so the idle buffers don't hold the pooled chunks.
+  void* Acquire(uint32_t index, bool refill = true) {
+    class_t& cls = class_arr_[index];
+    void* ptr = pop(cls);
+    if (ptr == NULL) ptr = allocate_chunk(cls);
+    if (refill && (free_count(cls) < low_)) wake_worker();
+    return ptr;
+  }
+
+  // Keeps the chunk up to the high watermark, frees it otherwise, the kept chunk is reset
+  void Release(uint32_t index, void* ptr) {
+    class_t& cls = class_arr_[index];
+    if (free_count(cls) < high_) {
+      cls.reset_fun(ptr, cls.size);
+      if (push(cls, ptr) == true) return;
+    }
+    free_chunk(cls, ptr);
+  }
+
+ private:
+  struct cell_t {
+    std::atomic<uint64_t> seq;
+    void* ptr;
+  };
+
+  struct class_t {
+    size_t size;
+    bool huge_pages;
+    reset_fun_t reset_fun;
+    uint32_t refs;
+    std::atomic<uint64_t> enqueue_pos;
+    std::atomic<uint64_t> dequeue_pos;
+    cell_t cell_arr[QUEUE_SIZE_MAX];
+  };
+
+  ChunkPool() : class_count_(0), refs_(0), stop_(false), refill_(false) {
+    high_ = get_env("ROCTRACER_CHUNK_POOL_HIGH", HIGH_WATERMARK);
+    if (high_ == 0) high_ = 1;
+    if (high_ > QUEUE_SIZE_MAX) high_ = QUEUE_SIZE_MAX;
+    low_ = get_env("ROCTRACER_CHUNK_POOL_LOW", LOW_WATERMARK);
+    if (low_ > high_) low_ = high_;
+    PTHREAD_CALL(pthread_mutex_init(&work_mutex_, NULL));
+    PTHREAD_CALL(pthread_cond_init(&work_cond_, NULL));
+  }
+
+  static uint32_t get_env(const char* name, uint32_t value) {
+    const char* str = getenv(name);
+    return (str != NULL) ? strtoul(str, NULL, 0) : value;
+  }
+
+  // Bounded MPMC queue of the free chunks, the queue size is the high watermark
+  bool push(class_t& cls, void* ptr) {
+    uint64_t pos = cls.enqueue_pos.load(std::memory_order_relaxed);
+    cell_t* cell = NULL;
+    while (1) {
+      cell = &cls.cell_arr[pos % high_];
+      const int64_t diff = (int64_t)cell->seq.load(std::memory_order_acquire) - (int64_t)pos;
+      if (diff == 0) {
+        if (cls.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = cls.enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->ptr = ptr;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  void* pop(class_t& cls) {
+    uint64_t pos = cls.dequeue_pos.load(std::memory_order_relaxed);
+    cell_t* cell = NULL;
+    while (1) {
+      cell = &cls.cell_arr[pos % high_];
+      const int64_t diff = (int64_t)cell->seq.load(std::memory_order_acquire) - (int64_t)(pos + 1);
+      if (diff == 0) {
+        if (cls.dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return NULL;
+      } else {
+        pos = cls.dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    void* ptr = cell->ptr;
+    cell->seq.store(pos + high_, std::memory_order_release);
+    return ptr;
+  }
+
+  uint32_t free_count(const class_t& cls) const {
+    const uint64_t enqueue_pos = cls.enqueue_pos.load(std::memory_order_relaxed);
+    const uint64_t dequeue_pos = cls.dequeue_pos.load(std::memory_order_relaxed);
+    return (enqueue_pos > dequeue_pos) ? enqueue_pos - dequeue_pos : 0;
+  }
+
+  // The chunks are page aligned anonymous mappings, the huge pages allocation header is one
+  // cache line. The mapped memory is zeroed and the pages are not touched here.
+  void* allocate_chunk(const class_t& cls) {
+    void* ptr = NULL;
+    if (cls.huge_pages) {
+      ptr = util::HugePageAllocator::Allocate(cls.size);
+    } else {
+      ptr = mmap(NULL, cls.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ptr == MAP_FAILED) ptr = NULL;
+    }
+    if (ptr == NULL) abort_run("ChunkPool::allocate_chunk: chunk allocation failed");
+    return ptr;
+  }
+
+  void free_chunk(const class_t& cls, void* ptr) {
+    if (cls.huge_pages) util::HugePageAllocator::Free((char*)ptr);
+    else munmap(ptr, cls.size);
+  }
+
+  void wake_worker() {
+    PTHREAD_CALL(pthread_mutex_lock(&work_mutex_));
+    refill_ = true;
+    PTHREAD_CALL(pthread_cond_signal(&work_cond_));
+    PTHREAD_CALL(pthread_mutex_unlock(&work_mutex_));
+  }
+
+  static void* refill_worker(void* arg) {
+    ChunkPool* obj = (ChunkPool*)arg;
+
+    PTHREAD_CALL(pthread_mutex_lock(&(obj->work_mutex_)));
+    while (1) {
+      while ((obj->stop_ == false) && (obj->refill_ == false)) {
+        PTHREAD_CALL(pthread_cond_wait(&(obj->work_cond_), &(obj->work_mutex_)));
+      }
+      if (obj->stop_ == true) break;
+      obj->refill_ = false;
+      PTHREAD_CALL(pthread_mutex_unlock(&(obj->work_mutex_)));
+
+      const uint32_t count = obj->class_count_.load(std::memory_order_acquire);
+      for (uint32_t i = 0; i < count; ++i) {
+        class_t& cls = obj->class_arr_[i];
+        while (obj->free_count(cls) < obj->high_) {
+          void* ptr = obj->allocate_chunk(cls);
+          if (obj->push(cls, ptr) == false) {
+            obj->free_chunk(cls, ptr);
+            break;
+          }
+        }
+      }
+
+      PTHREAD_CALL(pthread_mutex_lock(&(obj->work_mutex_)));
+    }
+    PTHREAD_CALL(pthread_mutex_unlock(&(obj->work_mutex_)));
+
+    return NULL;
+  }
+
+  static void abort_run(const char* str) {
+    fprintf(stderr, "%s\n", str);
+    fflush(stderr);
+    abort();
+  }
+
+  uint32_t low_;
+  uint32_t high_;
+  class_t class_arr_[CLASSES_MAX];
+  std::atomic<uint32_t> class_count_;
+
+  std::mutex ctl_mutex_;
+  uint32_t refs_;
+
+  pthread_t work_thread_;
+  pthread_mutex_t work_mutex_;
+  pthread_cond_t work_cond_;
+  bool stop_;
+  bool refill_;
+};
+}  // namespace roctracer
+
+#endif  // SRC_CORE_CHUNK_POOL_H_
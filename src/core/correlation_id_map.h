@@ -0,0 +1,151 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SRC_CORE_CORRELATION_ID_MAP_H_
+#define SRC_CORE_CORRELATION_ID_MAP_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+namespace roctracer {
+
+// Lock-free map of the correlation ids.
+// Open addressing table with linear probing, the entry is erased by the lookup and
+// its slot is left as a tombstone which is reused by the following inserts. The probe
+// sequence is bounded by PROBE_MAX slots, so the tombstones don't make the misses scan
+// the table. The keys not fitting their probe window, and the reserved key values, go
+// to the locked overflow map, so the map never gets full.
+// The ids are expected to be unique, a duplicate is detected if the previous one
+// is in the probe window or in the overflow map.
+template <uint32_t SizeBits = 16>
+class CorrelationIdMap {
+  public:
+  typedef uint64_t key_t;
+  typedef uint64_t value_t;
+
+  static const uint64_t SIZE = 1ULL << SizeBits;
+  static const uint64_t MASK = SIZE - 1;
+  static const uint64_t PROBE_MAX = (SIZE < 64) ? SIZE : 64;
+
+  CorrelationIdMap() : table_(), overflow_count_(0) {}
+
+  // Inserting a key/value pair, returns false if the key is present
+  bool Insert(const key_t& key, const value_t& value) {
+    if ((key == KEY_EMPTY) || (key >= KEY_RESERVED)) return overflow_insert(key, value);
+    if (overflow_find(key)) return false;
+    // The whole probe window is checked for the duplicate before claiming the first free slot
+    while (1) {
+      slot_t* free_slot = NULL;
+      key_t free_key = KEY_EMPTY;
+      for (uint64_t i = 0, index = hash(key); i < PROBE_MAX; ++i, index = (index + 1) & MASK) {
+        slot_t& slot = table_[index];
+        const key_t slot_key = slot.key.load(std::memory_order_acquire);
+        if (slot_key == key) return false;
+        if (((slot_key == KEY_EMPTY) || (slot_key == KEY_TOMB)) && (free_slot == NULL)) {
+          free_slot = &slot;
+          free_key = slot_key;
+        }
+        if (slot_key == KEY_EMPTY) break;
+      }
+      if (free_slot == NULL) break;
+      if (free_slot->key.compare_exchange_strong(free_key, KEY_RESERVED, std::memory_order_acquire)) {
+        free_slot->value.store(value, std::memory_order_relaxed);
+        free_slot->key.store(key, std::memory_order_release);
+        return true;
+      }
+    }
+    return overflow_insert(key, value);
+  }
+
+  // Looking up and erasing the key, returns false if the key is not found
+  bool Lookup(const key_t& key, value_t* value) {
+    if ((key == KEY_EMPTY) || (key >= KEY_RESERVED)) return overflow_lookup(key, value);
+    for (uint64_t i = 0, index = hash(key); i < PROBE_MAX; ++i, index = (index + 1) & MASK) {
+      slot_t& slot = table_[index];
+      key_t slot_key = slot.key.load(std::memory_order_acquire);
+      if (slot_key == KEY_EMPTY) break;
+      if ((slot_key == key) &&
+          slot.key.compare_exchange_strong(slot_key, KEY_RESERVED, std::memory_order_acquire)) {
+        *value = slot.value.load(std::memory_order_relaxed);
+        slot.key.store(KEY_TOMB, std::memory_order_release);
+        return true;
+      }
+    }
+    return overflow_lookup(key, value);
+  }
+
+  // Number of the keys in the overflow map
+  uint64_t OverflowCount() const { return overflow_count_.load(std::memory_order_acquire); }
+
+  private:
+  static const key_t KEY_EMPTY = 0;
+  static const key_t KEY_RESERVED = UINT64_MAX - 1;
+  static const key_t KEY_TOMB = UINT64_MAX;
+
+  struct slot_t {
+    std::atomic<key_t> key;
+    std::atomic<value_t> value;
+  };
+
+  typedef std::mutex mutex_t;
+  typedef std::map<key_t, value_t> overflow_map_t;
+
+  bool overflow_insert(const key_t& key, const value_t& value) {
+    std::lock_guard<mutex_t> lck(overflow_mutex_);
+    if (overflow_map_.insert({key, value}).second == false) return false;
+    overflow_count_.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  // The overflow map is locked only if it is not empty
+  bool overflow_find(const key_t& key) {
+    if (overflow_count_.load(std::memory_order_acquire) == 0) return false;
+    std::lock_guard<mutex_t> lck(overflow_mutex_);
+    return (overflow_map_.find(key) != overflow_map_.end());
+  }
+
+  bool overflow_lookup(const key_t& key, value_t* value) {
+    if (overflow_count_.load(std::memory_order_acquire) == 0) return false;
+    std::lock_guard<mutex_t> lck(overflow_mutex_);
+    typename overflow_map_t::iterator it = overflow_map_.find(key);
+    if (it == overflow_map_.end()) return false;
+    *value = it->second;
+    overflow_map_.erase(it);
+    overflow_count_.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  // Fibonacci hashing, the consecutive ids are spread over the table
+  static uint64_t hash(const key_t& key) { return (key * 0x9E3779B97F4A7C15ULL) >> (64 - SizeBits); }
+
+  slot_t table_[SIZE];
+  std::atomic<uint64_t> overflow_count_;
+  overflow_map_t overflow_map_;
+  mutex_t overflow_mutex_;
+};
+
+}  // namespace roctracer
+
+#endif  // SRC_CORE_CORRELATION_ID_MAP_H_
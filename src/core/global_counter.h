@@ -0,0 +1,57 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SRC_CORE_GLOBAL_COUNTER_H_
+#define SRC_CORE_GLOBAL_COUNTER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace roctracer {
+
+// Correlation id counter.
+// Each thread reserves a block of ids from the global atomic counter and hands them out
+// locally, the ids are unique and monotonic per thread.
+class GlobalCounter {
+  public:
+  typedef uint64_t counter_t;
+
+  static const counter_t BLOCK_SIZE = 256;
+
+  static counter_t Increment() {
+    if (next_ == end_) {
+      next_ = counter_.fetch_add(BLOCK_SIZE, std::memory_order_relaxed) + 1;
+      end_ = next_ + BLOCK_SIZE;
+    }
+    return next_++;
+  }
+
+  private:
+  static std::atomic<counter_t> counter_;
+  static thread_local counter_t next_;
+  static thread_local counter_t end_;
+};
+
+}  // namespace roctracer
+
+#endif  // SRC_CORE_GLOBAL_COUNTER_H_
@@ -23,17 +23,24 @@ THE SOFTWARE.
 #ifndef SRC_CORE_JOURNAL_H_
 #define SRC_CORE_JOURNAL_H_
 
-#include <map>
+#include <stdint.h>
+
 #include <mutex>
+#include <vector>
 
 namespace roctracer {
 
+// Enabled ops journal, replayed by roctracer_start/stop
+// The ops of a domain are kept in a dense array with a bitmask of the registered ops.
+// A domain registered as a whole is marked uniform and replayed by one domain level
+// call, so toggling the tracing is O(domains) instead of O(ops).
 template <class Data>
 class Journal {
   public:
   typedef std::mutex mutex_t;
-  typedef std::map<uint32_t, Data> domain_map_t;
-  typedef std::map<uint32_t, domain_map_t*> journal_map_t;
+
+  static const uint32_t DOMAIN_MAX = 32;
+  static const uint32_t WORD_BITS = 64;
 
   struct record_t {
     uint32_t domain;
@@ -41,59 +48,93 @@ class Journal {
     Data data;
   };
 
-  Journal() {
-    domain_mask_ = 0;
-    map_ = new journal_map_t;
+  Journal() : domain_mask_(0) {}
+
+  void registr(const record_t& record) {
+    std::lock_guard<mutex_t> lck(mutex_);
+    domain_t* domain = get_domain(record.domain);
+    if (domain == NULL) return;
+    const uint32_t op = record.op;
+    if (op >= domain->data.size()) {
+      domain->data.resize(op + 1);
+      domain->mask.resize(op / WORD_BITS + 1, 0);
+    }
+    domain->data[op] = record.data;
+    domain->mask[op / WORD_BITS] |= 1ULL << (op % WORD_BITS);
+    domain->uniform = false;
   }
 
-  ~Journal() {
-    for (auto& val : map_) delete val.second;
-    delete map_;
+  void remove(const record_t& record) {
+    std::lock_guard<mutex_t> lck(mutex_);
+    domain_t* domain = get_domain(record.domain);
+    if (domain == NULL) return;
+    const uint32_t op = record.op;
+    if (op < domain->data.size()) domain->mask[op / WORD_BITS] &= ~(1ULL << (op % WORD_BITS));
+    domain->uniform = false;
   }
 
-  void registr(const record_t& record) {
+  // All 'op_num' ops of the domain are registered with the same data
+  void registr_domain(const uint32_t& domain_id, const uint32_t& op_num, const Data& data) {
     std::lock_guard<mutex_t> lck(mutex_);
-    auto* map = get_domain_map(record.domain);
-    map->insert({record.op, record.data});
+    domain_t* domain = (op_num != 0) ? get_domain(domain_id) : NULL;
+    if (domain == NULL) return;
+    domain->data.assign(op_num, data);
+    domain->mask.assign((op_num + WORD_BITS - 1) / WORD_BITS, ~0ULL);
+    if (op_num % WORD_BITS) domain->mask.back() = (1ULL << (op_num % WORD_BITS)) - 1;
+    domain->uniform = true;
+    domain->uniform_data = data;
   }
 
-  void remove(const record_t& record) {
+  void remove_domain(const uint32_t& domain_id) {
     std::lock_guard<mutex_t> lck(mutex_);
-    auto* map = get_domain_map(record.domain);
-    map->erase(record.op);
+    domain_t* domain = get_domain(domain_id);
+    if (domain == NULL) return;
+    domain->mask.assign(domain->mask.size(), 0);
+    domain->uniform = false;
   }
 
+  // The functor 'fun_domain' is called for the uniform domains and 'fun' for the ops
+  // of the others, the iteration is stopped if a call returns false
   template <class F>
   F foreach(const F& f_i) {
     std::lock_guard<mutex_t> lck(mutex_);
     F f = f_i;
-    for (uint32_t domain = 0, mask = domain_mask_; mask != 0; ++domain, mask >>= 1) {
-      if (mask & 1) {
-        auto map = get_domain_map(domain);
-        auto begin = map->begin();
-        auto end = map->end();
-        for (auto it = begin; it != end; ++it) {
-          if (f.fun({domain, it->first, it->second}) == false) break;
+    for (uint32_t domain_id = 0, mask = domain_mask_; mask != 0; ++domain_id, mask >>= 1) {
+      if ((mask & 1) == 0) continue;
+      const domain_t& domain = domains_[domain_id];
+      if (domain.uniform) {
+        if (f.fun_domain(domain_id, domain.uniform_data) == false) break;
+        continue;
+      }
+      bool cont = true;
+      for (uint32_t word = 0; cont && (word < domain.mask.size()); ++word) {
+        for (uint64_t bits = domain.mask[word]; cont && (bits != 0); bits &= bits - 1) {
+          const uint32_t op = word * WORD_BITS + __builtin_ctzll(bits);
+          cont = f.fun({domain_id, op, domain.data[op]});
         }
       }
+      if (cont == false) break;
     }
     return f;
   }
 
   private:
-  domain_map_t* get_domain_map(const uint32_t& domain) {
+  struct domain_t {
+    domain_t() : uniform(false), uniform_data() {}
+    std::vector<Data> data;
+    std::vector<uint64_t> mask;
+    bool uniform;
+    Data uniform_data;
+  };
+
+  domain_t* get_domain(const uint32_t& domain) {
+    if (domain >= DOMAIN_MAX) return NULL;
     domain_mask_ |= 1u << domain;
-    auto domain_it = map_->find(domain);
-    if (domain_it == map_->end()) {
-      auto* domain_map = new domain_map_t;
-      auto ret = map_->insert({domain, domain_map});
-      domain_it = ret.first;
-    }
-    return domain_it->second;
+    return &domains_[domain];
   }
 
   mutex_t mutex_;
-  journal_map_t* map_;
+  domain_t domains_[DOMAIN_MAX];
   uint32_t domain_mask_;
 };
 
@@ -128,14 +128,20 @@ class KfdApi {
 
   typedef bool (RegisterApiCallback_t)(uint32_t op, void* callback, void* arg);
   typedef bool (RemoveApiCallback_t)(uint32_t op);
+  typedef bool (RegisterApiCallbackAll_t)(void* callback, void* arg);
+  typedef bool (RemoveApiCallbackAll_t)();
 
   RegisterApiCallback_t* RegisterApiCallback;
   RemoveApiCallback_t* RemoveApiCallback;
+  RegisterApiCallbackAll_t* RegisterApiCallbackAll;
+  RemoveApiCallbackAll_t* RemoveApiCallbackAll;
 
   protected:
   void init(Loader* loader) {
     RegisterApiCallback = loader->GetFun<RegisterApiCallback_t>("RegisterApiCallback");
     RemoveApiCallback = loader->GetFun<RemoveApiCallback_t>("RemoveApiCallback");
+    RegisterApiCallbackAll = loader->GetFun<RegisterApiCallbackAll_t>("RegisterApiCallbackAll");
+    RemoveApiCallbackAll = loader->GetFun<RemoveApiCallbackAll_t>("RemoveApiCallbackAll");
   }
 };
 
@@ -147,16 +153,22 @@ class RocTxApi {
 
   typedef decltype(RegisterApiCallback) RegisterApiCallback_t;
   typedef decltype(RemoveApiCallback) RemoveApiCallback_t;
+  typedef decltype(RegisterApiCallbackAll) RegisterApiCallbackAll_t;
+  typedef decltype(RemoveApiCallbackAll) RemoveApiCallbackAll_t;
   typedef decltype(RangeStackIterate) RangeStackIterate_t;
 
   RegisterApiCallback_t* RegisterApiCallback;
   RemoveApiCallback_t* RemoveApiCallback;
+  RegisterApiCallbackAll_t* RegisterApiCallbackAll;
+  RemoveApiCallbackAll_t* RemoveApiCallbackAll;
   RangeStackIterate_t* RangeStackIterate;
 
   protected:
   void init(Loader* loader) {
     RegisterApiCallback = loader->GetFun<RegisterApiCallback_t>("RegisterApiCallback");
     RemoveApiCallback = loader->GetFun<RemoveApiCallback_t>("RemoveApiCallback");
+    RegisterApiCallbackAll = loader->GetFun<RegisterApiCallbackAll_t>("RegisterApiCallbackAll");
+    RemoveApiCallbackAll = loader->GetFun<RemoveApiCallbackAll_t>("RemoveApiCallbackAll");
     RangeStackIterate = loader->GetFun<RangeStackIterate_t>("RangeStackIterate");
   }
 };
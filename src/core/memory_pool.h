@@ -23,13 +23,24 @@ THE SOFTWARE.
 #ifndef MEMORY_POOL_H_
 #define MEMORY_POOL_H_
 
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <atomic>
 #include <mutex>
 
 #include "util/exception.h"
+#include "util/huge_page_allocator.h"
 
 #define PTHREAD_CALL(call)                                                                         \
   do {                                                                                             \
@@ -47,6 +58,28 @@ class MemoryPool {
   public:
   typedef std::mutex mutex_t;
 
+  // Default number of the pool buffers
+  static const uint32_t BUFFER_COUNT_DEFAULT = 2;
+
+  // Thread chunks mode parameters
+  static const uint32_t CHUNKS_PER_BUFFER = 64;
+  static const size_t CHUNK_MIN_SIZE = 0x1000;
+
+  // Infinite flush wait timeout
+  static const uint32_t TIMEOUT_INFINITE = UINT32_MAX;
+
+  // Max number of the chunk pools with a cached writer per thread, the pools beyond it replace the writers
+  static const uint32_t WRITERS_MAX = 16;
+
+  // Max number of the pools with the flight recorder dump signal
+  static const uint32_t SIGNAL_POOLS_MAX = 16;
+
+  // Framed records alignment, the padding record fits any aligned gap
+  static const size_t RECORD_ALIGN = sizeof(roctracer_record_header_t);
+
+  // File-backed pool header size, the file buffers are page aligned
+  static const size_t FILE_HEADER_SIZE = 0x1000;
+
   static void allocator_default(char** ptr, size_t size, void* arg) {
     (void)arg;
     if (*ptr == NULL) {
@@ -60,127 +93,701 @@ class MemoryPool {
   }
 
   MemoryPool(const roctracer_properties_t& properties) { 
-    // Assigning pool allocator
-    alloc_fun_ = allocator_default;
+    // Assigning pool allocator, the huge pages one is the default if enabled by the environment
+    alloc_fun_ = (util::HugePageAllocator::Enabled()) ? util::HugePageAllocator::allocator : allocator_default;
     alloc_arg_ = NULL;
     if (properties.alloc_fun != NULL) {
       alloc_fun_ = properties.alloc_fun;
       alloc_arg_ = properties.alloc_arg;
     }
 
-    // Pool definition
+    // Pool definition, the pool is a ring of the buffers
     buffer_size_ = properties.buffer_size;
-    const size_t pool_size = 2 * buffer_size_;
+    buffer_count_ = (properties.buffer_count != 0) ? properties.buffer_count : BUFFER_COUNT_DEFAULT;
+    if (buffer_count_ < 2) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "buffer count(" << buffer_count_ << ") is less then 2");
+
+    // Back-pressure policy, the flight recorder always overwrites the oldest records
+    policy_ = properties.mode & ROCTRACER_POOL_MODE_POLICY_MASK;
+    if ((policy_ != ROCTRACER_POOL_MODE_BLOCK) &&
+        (policy_ != ROCTRACER_POOL_MODE_DROP_NEWEST) &&
+        (policy_ != ROCTRACER_POOL_MODE_OVERWRITE_OLDEST)) {
+      EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "bad pool mode(" << properties.mode << ")");
+    }
+    flight_recorder_ = (properties.mode & ROCTRACER_POOL_MODE_FLIGHT_RECORDER) != 0;
+    if (flight_recorder_) policy_ = ROCTRACER_POOL_MODE_OVERWRITE_OLDEST;
+    if (!flight_recorder_ && ((properties.trigger_fun != NULL) || (properties.dump_signal != 0))) {
+      EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "dump trigger requires flight recorder mode");
+    }
+    if ((properties.dump_signal < 0) || (properties.dump_signal >= NSIG)) {
+      EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "bad dump signal(" << properties.dump_signal << ")");
+    }
+
+    // File-backed pool, the records are framed to keep the file readable
+    file_mode_ = (properties.mode & ROCTRACER_POOL_MODE_FILE) != 0;
+    if (file_mode_) {
+      if (properties.file_name == NULL) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "file-backed pool requires file name");
+      if (policy_ == ROCTRACER_POOL_MODE_OVERWRITE_OLDEST) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "file-backed pool cannot overwrite records");
+      const size_t page_size = sysconf(_SC_PAGESIZE);
+      buffer_size_ = (buffer_size_ + page_size - 1) & ~(page_size - 1);
+    } else if (properties.buffer_callback_fun == NULL) {
+      EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "buffer callback is NULL");
+    }
+
+    // Pool allocation
+    const size_t pool_size = buffer_count_ * buffer_size_;
     pool_begin_ = NULL;
-    alloc_fun_(&pool_begin_, pool_size, alloc_arg_);
+    if (file_mode_) open_file(properties.file_name, pool_size);
+    else alloc_fun_(&pool_begin_, pool_size, alloc_arg_);
     if (pool_begin_ == NULL) EXC_ABORT(ROCTRACER_STATUS_ERROR, "pool allocator failed");
     pool_end_ = pool_begin_ + pool_size;
     buffer_begin_ = pool_begin_;
     buffer_end_ = buffer_begin_ + buffer_size_;
     write_ptr_ = buffer_begin_;
+    buffer_arr_ = new buffer_t[buffer_count_];
+    write_index_ = 0;
+    read_index_ = 0;
+    write_count_ = 0;
+    is_reading_ = false;
+    wait_count_ = 0;
+    dump_index_ = 0;
+    stop_ = false;
+    drain_abort_.store(false);
+    drain_timeout_ = properties.drain_timeout;
+    dropped_count_.store(0);
+
+    // Framed variable length records
+    var_mode_ = file_mode_ || ((properties.mode & ROCTRACER_POOL_MODE_VAR_RECORDS) != 0);
+
+    // Per-thread chunks, the pool buffers are split into the chunks
+    chunk_mode_ = (properties.mode & ROCTRACER_POOL_MODE_THREAD_CHUNKS) != 0;
+    chunk_size_ = 0;
+    chunk_count_ = 0;
+    chunk_arr_ = NULL;
+    if (chunk_mode_) {
+      chunk_size_ = buffer_size_ / CHUNKS_PER_BUFFER;
+      if (chunk_size_ < CHUNK_MIN_SIZE) chunk_size_ = (buffer_size_ < CHUNK_MIN_SIZE) ? buffer_size_ : CHUNK_MIN_SIZE;
+      if (var_mode_) chunk_size_ &= ~(RECORD_ALIGN - 1);
+      chunk_count_ = buffer_size_ / chunk_size_;
+      chunk_arr_ = new chunk_t[buffer_count_ * chunk_count_];
+      pool_id_ = next_pool_id();
+      gen_wrap_ = ((uint64_t(1) << 32) / buffer_count_) * buffer_count_;
+      reset_chunks(0);
+      chunk_state_.store(0);
+    }
 
     // Consuming read thread
     read_callback_fun_ = properties.buffer_callback_fun;
     read_callback_arg_ = properties.buffer_callback_arg;
-    consumer_arg_.set(this, NULL, NULL, true);
     PTHREAD_CALL(pthread_mutex_init(&read_mutex_, NULL));
     PTHREAD_CALL(pthread_cond_init(&read_cond_, NULL));
-    PTHREAD_CALL(pthread_create(&consumer_thread_, NULL, reader_fun, &consumer_arg_));
+    PTHREAD_CALL(pthread_cond_init(&free_cond_, NULL));
+    PTHREAD_CALL(pthread_create(&consumer_thread_, NULL, reader_fun, this));
+
+    // Flight recorder dump triggers
+    trigger_fun_ = properties.trigger_fun;
+    trigger_arg_ = properties.trigger_arg;
+    dump_signal_ = properties.dump_signal;
+    if (dump_signal_ != 0) {
+      dump_stop_.store(false);
+      if (sem_init(&dump_sem_, 0, 0) != 0) EXC_ABORT(ROCTRACER_STATUS_ERROR, "dump semaphore init failed");
+      PTHREAD_CALL(pthread_create(&dump_thread_, NULL, dump_fun, this));
+      register_signal();
+    }
   }
 
   ~MemoryPool() {
-    Flush();
-    PTHREAD_CALL(pthread_cancel(consumer_thread_));
-    void *res;
-    PTHREAD_CALL(pthread_join(consumer_thread_, &res));
-    if (res != PTHREAD_CANCELED) EXC_ABORT(ROCTRACER_STATUS_ERROR, "consumer thread wasn't stopped correctly");
-    allocator_default(&pool_begin_, 0, alloc_arg_);
+    if (dump_signal_ != 0) {
+      unregister_signal();
+      dump_stop_.store(true);
+      sem_post(&dump_sem_);
+      PTHREAD_CALL(pthread_join(dump_thread_, NULL));
+      sem_destroy(&dump_sem_);
+    }
+    close_reader(FlushAsync());
+    if (file_mode_) close_file();
+    else alloc_fun_(&pool_begin_, 0, alloc_arg_);
+    delete[] buffer_arr_;
+    delete[] chunk_arr_;
   }
 
   template <typename Record>
   void Write(const Record& record) {
+    writeRecord<Record>(record, NULL, 0);
+    if (trigger_fun_ != NULL) check_trigger(record);
+  }
+
+  // Writing the activity record with the payload copied inline, the records are framed
+  // in the var records mode only
+  void WriteVar(const activity_record_t& record, const void* payload, const uint32_t& payload_size) {
+    if (!var_mode_ && (payload_size != 0)) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "pool is not in var records mode");
+    const size_t size = record_size(sizeof(record), payload_size);
+    const size_t max_size = (chunk_mode_) ? chunk_size_ : buffer_size_;
+    if (size > max_size) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "record size(" << size << ") is more then " << max_size);
+    writeRecord<activity_record_t>(record, payload, payload_size);
+    if (trigger_fun_ != NULL) check_trigger(record);
+  }
+
+  // Flush waits for the reader to consume all records written so far
+  void Flush() { WaitFlush(FlushAsync(), TIMEOUT_INFINITE); }
+
+  // Submitting the current buffer without waiting for the reader, the flight recorder dumps
+  // the retained records. Waits for a free buffer whatever the back-pressure policy is.
+  // Returns the flush completion index.
+  uint64_t FlushAsync() {
+    if (flight_recorder_) return Dump();
     std::lock_guard<mutex_t> lock(write_mutex_);
-    getRecord<Record>(record);
+    if (chunk_mode_) {
+      const uint64_t state = chunk_state_.load();
+      if (chunks_used(state)) swap_chunks(state, true);
+    } else if (write_ptr_ > buffer_begin_) {
+      wait_buffer(true);
+      submit_buffer(buffer_begin_, write_ptr_, write_count_);
+      next_buffer();
+    }
+    PTHREAD_CALL(pthread_mutex_lock(&read_mutex_));
+    const uint64_t index = write_index_;
+    PTHREAD_CALL(pthread_mutex_unlock(&read_mutex_));
+    return index;
+  }
+
+  // Waiting for the reader to pass the flush completion index, the timeout is in milliseconds.
+  // Returns false on the timeout.
+  bool WaitFlush(const uint64_t& index, const uint32_t& timeout) {
+    PTHREAD_CALL(pthread_mutex_lock(&read_mutex_));
+    const bool ret = wait_reader(index, timeout);
+    PTHREAD_CALL(pthread_mutex_unlock(&read_mutex_));
+    return ret;
   }
 
-  void Flush() {
+  // Flight recorder dump, passing the retained buffers to the reader from the oldest to the newest one.
+  // Returns the dump completion index.
+  uint64_t Dump() {
     std::lock_guard<mutex_t> lock(write_mutex_);
-    if (write_ptr_ > buffer_begin_) {
-      spawn_reader(buffer_begin_, write_ptr_);
-      sync_reader(&consumer_arg_);
-      buffer_begin_ = (buffer_end_ == pool_end_) ? pool_begin_ : buffer_end_;
-      buffer_end_ = buffer_begin_ + buffer_size_;
-      write_ptr_ = buffer_begin_;
+    if (chunk_mode_) {
+      const uint64_t state = chunk_state_.load();
+      if (chunks_used(state)) swap_chunks(state, false);
+    } else if ((write_ptr_ > buffer_begin_) && wait_buffer(false)) {
+      submit_buffer(buffer_begin_, write_ptr_, write_count_);
+      next_buffer();
     }
+    PTHREAD_CALL(pthread_mutex_lock(&read_mutex_));
+    dump_index_ = write_index_;
+    const uint64_t index = dump_index_;
+    PTHREAD_CALL(pthread_cond_signal(&read_cond_));
+    PTHREAD_CALL(pthread_mutex_unlock(&read_mutex_));
+    return index;
+  }
+
+  // Number of times the producers waited for a free buffer
+  uint64_t WaitCount() {
+    PTHREAD_CALL(pthread_mutex_lock(&read_mutex_));
+    const uint64_t count = wait_count_;
+    PTHREAD_CALL(pthread_mutex_unlock(&read_mutex_));
+    return count;
   }
 
+  // Number of the dropped and overwritten records
+  uint64_t DroppedCount() const { return dropped_count_.load(std::memory_order_relaxed); }
+
   private:
-  struct consumer_arg_t {
-    MemoryPool* obj;
+  // Submitted buffer records range
+  struct buffer_t {
     const char* begin;
     const char* end;
-    volatile std::atomic<bool> valid;
-    void set(MemoryPool* obj_p, const char* begin_p, const char* end_p, bool valid_p) {
-      obj = obj_p;
-      begin = begin_p;
-      end = end_p;
-      valid.store(valid_p);
-    }
+    uint64_t count;
   };
 
+  // Writer chunk descriptor, padded to a cache line as it is written by the owning thread only
+  struct chunk_t {
+    std::atomic<char*> end;                               // committed records end
+    std::atomic<uint32_t> busy;                           // writing a record, cleared by the setter only
+    std::atomic<uint32_t> count;                          // committed records number
+    char pad[64 - sizeof(std::atomic<char*>) - 2 * sizeof(std::atomic<uint32_t>)];
+  };
+
+  // Writer thread current chunk
+  struct writer_t {
+    uint32_t pool_id;
+    uint32_t gen;
+    chunk_t* chunk;
+    char* ptr;
+    char* end;
+  };
+
+  // Flight recorder trigger predicate is checked for the activity records,
+  // the dump is requested without waiting for the reader
   template <typename Record>
-  Record* getRecord(const Record& init) {
-    char* next = write_ptr_ + sizeof(Record);
+  void check_trigger(const Record&) {}
+  void check_trigger(const activity_record_t& record) {
+    if (trigger_fun_(&record, trigger_arg_)) Dump();
+  }
+
+  // Pools with the dump signal, the signal handler posts the pool dump semaphore
+  static std::atomic<MemoryPool*>* signal_pools() {
+    static std::atomic<MemoryPool*> pools[SIGNAL_POOLS_MAX];
+    return pools;
+  }
+
+  static void signal_handler(int signo) {
+    std::atomic<MemoryPool*>* pools = signal_pools();
+    for (uint32_t i = 0; i < SIGNAL_POOLS_MAX; ++i) {
+      MemoryPool* obj = pools[i].load();
+      if ((obj != NULL) && (obj->dump_signal_ == signo)) sem_post(&(obj->dump_sem_));
+    }
+  }
+
+  // Process-wide original signal actions and the signal users number, guarded by the signal mutex.
+  // The original action is saved by the first pool using the signal.
+  static mutex_t* signal_mutex() {
+    static mutex_t mutex;
+    return &mutex;
+  }
+  static struct sigaction* signal_actions() {
+    static struct sigaction actions[NSIG];
+    return actions;
+  }
+  static uint32_t* signal_users() {
+    static uint32_t users[NSIG];
+    return users;
+  }
+
+  void register_signal() {
+    std::lock_guard<mutex_t> lock(*signal_mutex());
+    std::atomic<MemoryPool*>* pools = signal_pools();
+    uint32_t i = 0;
+    for (; i < SIGNAL_POOLS_MAX; ++i) {
+      MemoryPool* expected = NULL;
+      if (pools[i].compare_exchange_strong(expected, this)) break;
+    }
+    if (i == SIGNAL_POOLS_MAX) EXC_ABORT(ROCTRACER_STATUS_ERROR, "too many pools with dump signal");
+
+    uint32_t* users = signal_users();
+    if (users[dump_signal_] == 0) {
+      struct sigaction action{};
+      action.sa_handler = signal_handler;
+      action.sa_flags = SA_RESTART;
+      sigemptyset(&action.sa_mask);
+      if (sigaction(dump_signal_, &action, &signal_actions()[dump_signal_]) != 0) {
+        pools[i].store(NULL);
+        EXC_ABORT(ROCTRACER_STATUS_ERROR, "sigaction(" << dump_signal_ << ") failed");
+      }
+    }
+    ++users[dump_signal_];
+  }
+
+  // The original signal action is restored by the last pool using the signal
+  void unregister_signal() {
+    std::lock_guard<mutex_t> lock(*signal_mutex());
+    std::atomic<MemoryPool*>* pools = signal_pools();
+    for (uint32_t i = 0; i < SIGNAL_POOLS_MAX; ++i) {
+      if (pools[i].load() == this) pools[i].store(NULL);
+    }
+    uint32_t* users = signal_users();
+    if (--users[dump_signal_] == 0) sigaction(dump_signal_, &signal_actions()[dump_signal_], NULL);
+  }
+
+  // Dump thread, the dump is not safe to run in the signal handler context
+  static void* dump_fun(void* arg) {
+    roctracer::MemoryPool* obj = reinterpret_cast<roctracer::MemoryPool*>(arg);
+    while (1) {
+      while (sem_wait(&(obj->dump_sem_)) != 0) {}
+      if (obj->dump_stop_.load()) break;
+      obj->Dump();
+    }
+    return NULL;
+  }
+
+  // Size of the record in the pool, the framed record size is aligned to keep the headers aligned
+  size_t record_size(const size_t& data_size, const uint32_t& payload_size) const {
+    if (!var_mode_) return data_size;
+    const size_t size = sizeof(roctracer_record_header_t) + data_size + payload_size;
+    return (size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+  }
+
+  template <typename Record>
+  void copyRecord(char* ptr, const size_t& size, const Record& record, const void* payload, const uint32_t& payload_size) {
+    if (var_mode_) {
+      roctracer_record_header_t* header = reinterpret_cast<roctracer_record_header_t*>(ptr);
+      header->size = size;
+      header->type = ROCTRACER_RECORD_TYPE_ACTIVITY;
+      header->payload_size = payload_size;
+      header->reserved = 0;
+      ptr += sizeof(roctracer_record_header_t);
+    }
+    *reinterpret_cast<Record*>(ptr) = record;
+    if (payload != NULL) memcpy(ptr + sizeof(Record), payload, payload_size);
+  }
+
+  template <typename Record>
+  void writeRecord(const Record& record, const void* payload, const uint32_t& payload_size) {
+    const size_t size = record_size(sizeof(Record), payload_size);
+    if (chunk_mode_) {
+      writeChunk<Record>(size, record, payload, payload_size);
+    } else {
+      std::lock_guard<mutex_t> lock(write_mutex_);
+      char* ptr = getRecord(size);
+      if (ptr != NULL) copyRecord<Record>(ptr, size, record, payload, payload_size);
+    }
+  }
+
+  char* getRecord(const size_t& size) {
+    char* next = write_ptr_ + size;
     if (next > buffer_end_) {
-      if (write_ptr_ == buffer_begin_) EXC_ABORT(ROCTRACER_STATUS_ERROR, "buffer size(" << buffer_size_ << ") is less then the record(" << sizeof(Record) << ")");
-      spawn_reader(buffer_begin_, write_ptr_);
-      buffer_begin_ = (buffer_end_ == pool_end_) ? pool_begin_ : buffer_end_;
-      buffer_end_ = buffer_begin_ + buffer_size_;
-      write_ptr_ = buffer_begin_;
-      next = write_ptr_ + sizeof(Record);
+      if (write_ptr_ == buffer_begin_) EXC_ABORT(ROCTRACER_STATUS_ERROR, "buffer size(" << buffer_size_ << ") is less then the record(" << size << ")");
+      if (wait_buffer(false) == false) {
+        dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+      }
+      submit_buffer(buffer_begin_, write_ptr_, write_count_);
+      next_buffer();
+      next = write_ptr_ + size;
     }
 
-    Record* ptr = reinterpret_cast<Record*>(write_ptr_);
+    char* ptr = write_ptr_;
     write_ptr_ = next;
-
-    *ptr = init;
+    ++write_count_;
     return ptr;
   }
 
-  static void reset_reader(consumer_arg_t* arg) {
-    arg->valid.store(false);
+  // Switching to the next ring buffer, the buffer has to be free
+  void next_buffer() {
+    buffer_begin_ = pool_begin_ + (write_index_ % buffer_count_) * buffer_size_;
+    buffer_end_ = buffer_begin_ + buffer_size_;
+    write_ptr_ = buffer_begin_;
+    write_count_ = 0;
+  }
+
+  static uint32_t next_pool_id() {
+    static std::atomic<uint32_t> counter{0};
+    return ++counter;
+  }
+
+  // Thread writers are keyed by the full pool id, the pool id home slot is checked first.
+  // A pool without a writer takes its free home slot or replaces the writers round-robin,
+  // the taken writer is set to the pool by claiming a new chunk.
+  static writer_t* get_writer(const uint32_t& pool_id) {
+    static thread_local writer_t writers[WRITERS_MAX];
+    static thread_local uint32_t victim = 0;
+    writer_t* home = &writers[pool_id % WRITERS_MAX];
+    if (home->pool_id == pool_id) return home;
+    for (uint32_t i = 0; i < WRITERS_MAX; ++i) {
+      if (writers[i].pool_id == pool_id) return &writers[i];
+    }
+    if (home->pool_id == 0) return home;
+    return &writers[victim++ % WRITERS_MAX];
   }
 
-  static void sync_reader(const consumer_arg_t* arg) {
-    while(arg->valid.load() == true) PTHREAD_CALL(pthread_yield());
+  // Chunk state is the current generation in the high half and the next chunk index in the low one.
+  // The generation is the write index of the ring buffer being written, it wraps at a multiple
+  // of the buffers number to select the same ring buffer as the 64-bit write and read indexes.
+  // The chunk index never passes the chunks number as the chunks are claimed with CAS.
+  static uint32_t chunk_gen(const uint64_t& state) { return state >> 32; }
+  static uint32_t chunk_index(const uint64_t& state) { return state & 0xffffffff; }
+  char* chunk_begin(const uint64_t& gen, const uint32_t& index) const {
+    return pool_begin_ + (gen % buffer_count_) * buffer_size_ + index * chunk_size_;
+  }
+  chunk_t* chunk_desc(const uint64_t& gen, const uint32_t& index) const {
+    return &chunk_arr_[(gen % buffer_count_) * chunk_count_ + index];
+  }
+  bool chunks_used(const uint64_t& state) const {
+    const uint32_t gen = chunk_gen(state);
+    const uint32_t count = chunk_index(state);
+    for (uint32_t i = 0; i < count; ++i) {
+      if (chunk_desc(gen, i)->end.load(std::memory_order_acquire) != chunk_begin(gen, i)) return true;
+    }
+    return false;
   }
 
-  static void* reader_fun(void* consumer_arg) {
-    consumer_arg_t* arg = reinterpret_cast<consumer_arg_t*>(consumer_arg);
-    roctracer::MemoryPool* obj = arg->obj;
+  void reset_chunks(const uint64_t& gen) {
+    for (uint32_t i = 0; i < chunk_count_; ++i) {
+      chunk_t* chunk = chunk_desc(gen, i);
+      chunk->end.store(chunk_begin(gen, i), std::memory_order_relaxed);
+      chunk->busy.store(0, std::memory_order_relaxed);
+      chunk->count.store(0, std::memory_order_relaxed);
+    }
+  }
 
-    reset_reader(arg);
+  // Lock-free write to the calling thread chunk, the pool lock is taken only to swap the buffers
+  template <typename Record>
+  void writeChunk(const size_t& size, const Record& record, const void* payload, const uint32_t& payload_size) {
+    if (size > chunk_size_) EXC_ABORT(ROCTRACER_STATUS_ERROR, "chunk size(" << chunk_size_ << ") is less then the record(" << size << ")");
+    writer_t* writer = get_writer(pool_id_);
 
     while (1) {
-      PTHREAD_CALL(pthread_mutex_lock(&(obj->read_mutex_)));
-      while (arg->valid.load() == false) {
-        PTHREAD_CALL(pthread_cond_wait(&(obj->read_cond_), &(obj->read_mutex_)));
+      if ((writer->pool_id == pool_id_) && ((writer->ptr + size) <= writer->end)) {
+        chunk_t* chunk = writer->chunk;
+        // The busy flag is set by CAS and cleared by the setting thread only, a stale writer
+        // of an older generation of the ring slot cannot clear the flag of the slot owner.
+        // The busy flag CAS and the generation load are ordered against the swap_chunks() ones.
+        uint32_t idle = 0;
+        if (chunk->busy.compare_exchange_strong(idle, 1)) {
+          if (chunk_gen(chunk_state_.load()) == writer->gen) {
+            copyRecord<Record>(writer->ptr, size, record, payload, payload_size);
+            writer->ptr += size;
+            chunk->count.store(chunk->count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            chunk->end.store(writer->ptr, std::memory_order_release);
+            chunk->busy.store(0, std::memory_order_release);
+            return;
+          }
+          chunk->busy.store(0, std::memory_order_release);
+        } else if (chunk_gen(chunk_state_.load()) == writer->gen) {
+          // The owner waits for a stale writer to release the flag
+          sched_yield();
+          continue;
+        }
       }
 
-      obj->read_callback_fun_(arg->begin, arg->end, obj->read_callback_arg_);
-      reset_reader(arg);
-      PTHREAD_CALL(pthread_mutex_unlock(&(obj->read_mutex_)));
+      // Claiming a new chunk, the state is not changed if all the chunks are claimed
+      uint64_t state = chunk_state_.load();
+      while ((chunk_index(state) < chunk_count_) && !chunk_state_.compare_exchange_weak(state, state + 1)) {}
+      const uint32_t gen = chunk_gen(state);
+      const uint32_t index = chunk_index(state);
+      if (index < chunk_count_) {
+        writer->pool_id = pool_id_;
+        writer->gen = gen;
+        writer->chunk = chunk_desc(gen, index);
+        writer->ptr = chunk_begin(gen, index);
+        writer->end = writer->ptr + chunk_size_;
+      } else {
+        std::lock_guard<mutex_t> lock(write_mutex_);
+        if (chunk_gen(chunk_state_.load()) == gen) {
+          if (swap_chunks(state, false) == false) {
+            dropped_count_.fetch_add(1, std::memory_order_relaxed);
+            return;
+          }
+        }
+      }
     }
+  }
 
-    return NULL;
+  // Switching the writers to the next ring buffer and passing the written chunks to the reader,
+  // called under the pool lock, returns false if there is no free buffer and the policy is not blocking
+  bool swap_chunks(const uint64_t& state, const bool& block) {
+    const uint32_t gen = chunk_gen(state);
+    const uint32_t next_gen = ((uint64_t(gen) + 1) == gen_wrap_) ? 0 : gen + 1;
+    if (wait_buffer(block) == false) return false;
+    reset_chunks(next_gen);
+    chunk_state_.store(uint64_t(next_gen) << 32);
+
+    // Waiting for the in-flight writes to the released chunks
+    uint64_t count = 0;
+    for (uint32_t i = 0; i < chunk_count_; ++i) {
+      chunk_t* chunk = chunk_desc(gen, i);
+      while (chunk->busy.load() != 0) sched_yield();
+      count += chunk->count.load(std::memory_order_relaxed);
+    }
+
+    const char* begin = chunk_begin(gen, 0);
+    submit_buffer(begin, begin + buffer_size_, count);
+    return true;
+  }
+
+  // Passing every written chunk of the given ring buffer to the reader callback,
+  // the rest of the chunks is dropped if the drain is aborted
+  void read_chunks(const uint64_t& gen) {
+    for (uint32_t i = 0; i < chunk_count_; ++i) {
+      const char* chunk_ptr = chunk_begin(gen, i);
+      const char* chunk_end = chunk_desc(gen, i)->end.load(std::memory_order_acquire);
+      if (drain_abort_.load(std::memory_order_relaxed)) {
+        dropped_count_.fetch_add(chunk_desc(gen, i)->count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      } else if ((chunk_end > chunk_ptr) && (read_callback_fun_ != NULL)) {
+        read_callback_fun_(chunk_ptr, chunk_end, read_callback_arg_);
+      }
+    }
+  }
+
+  // Writing the padding record to the gap between the framed records
+  static void pad_records(char* begin, char* end) {
+    if (begin < end) {
+      roctracer_record_header_t* header = reinterpret_cast<roctracer_record_header_t*>(begin);
+      header->size = end - begin;
+      header->type = ROCTRACER_RECORD_TYPE_PAD;
+      header->payload_size = 0;
+      header->reserved = 0;
+    }
+  }
+
+  // Mapping the pool buffers to the output file, the file starts with the header page
+  // followed by the buffers in the submit order. The ring buffer of the given index
+  // is mapped to the file buffer 'index + buffer_count * n'.
+  void open_file(const char* file_name, const size_t& pool_size) {
+    file_fd_ = open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file_fd_ < 0) EXC_RAISING(ROCTRACER_STATUS_ERROR, "open(" << file_name << ") failed, errno(" << errno << ")");
+    if (ftruncate(file_fd_, FILE_HEADER_SIZE + pool_size) != 0) EXC_ABORT(ROCTRACER_STATUS_ERROR, "file truncate failed");
+
+    void* header = mmap(NULL, FILE_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, file_fd_, 0);
+    if (header == MAP_FAILED) EXC_ABORT(ROCTRACER_STATUS_ERROR, "file header mmap failed");
+    file_header_ = reinterpret_cast<roctracer_pool_file_header_t*>(header);
+    file_header_->magic = ROCTRACER_POOL_FILE_MAGIC;
+    file_header_->version = ROCTRACER_POOL_FILE_VERSION;
+    file_header_->header_size = FILE_HEADER_SIZE;
+    file_header_->buffer_size = buffer_size_;
+    file_header_->committed_size = 0;
+
+    void* pool = mmap(NULL, pool_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (pool == MAP_FAILED) EXC_ABORT(ROCTRACER_STATUS_ERROR, "pool mmap failed");
+    pool_begin_ = reinterpret_cast<char*>(pool);
+    for (uint32_t i = 0; i < buffer_count_; ++i) map_file_buffer(i);
+  }
+
+  void map_file_buffer(const uint64_t& index) {
+    const off_t offset = FILE_HEADER_SIZE + index * buffer_size_;
+    char* ptr = pool_begin_ + (index % buffer_count_) * buffer_size_;
+    void* ret = mmap(ptr, buffer_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, file_fd_, offset);
+    if (ret == MAP_FAILED) EXC_ABORT(ROCTRACER_STATUS_ERROR, "file buffer mmap failed, errno(" << errno << ")");
+  }
+
+  // Committing the read ring buffer to the file, the buffer gaps are padded and the file header
+  // is advanced. The ring buffer is remapped to the next file buffer, called by the reader.
+  void commit_file_buffer(const uint64_t& index, const buffer_t& buffer) {
+    char* begin = pool_begin_ + (index % buffer_count_) * buffer_size_;
+    char* end = begin + buffer_size_;
+    if (chunk_mode_) {
+      for (uint32_t i = 0; i < chunk_count_; ++i) {
+        pad_records(chunk_desc(index, i)->end.load(std::memory_order_acquire), chunk_begin(index, i) + chunk_size_);
+      }
+      pad_records(chunk_begin(index, chunk_count_), end);
+    } else {
+      pad_records(const_cast<char*>(buffer.end), end);
+    }
+    msync(begin, buffer_size_, MS_ASYNC);
+    std::atomic_thread_fence(std::memory_order_release);
+    file_header_->committed_size = (index + 1) * buffer_size_;
+
+    const uint64_t next_index = index + buffer_count_;
+    if (ftruncate(file_fd_, FILE_HEADER_SIZE + (next_index + 1) * buffer_size_) != 0) {
+      EXC_ABORT(ROCTRACER_STATUS_ERROR, "file truncate failed, errno(" << errno << ")");
+    }
+    map_file_buffer(next_index);
+  }
+
+  // The file is truncated to the committed buffers
+  void close_file() {
+    const off_t size = FILE_HEADER_SIZE + file_header_->committed_size;
+    munmap(pool_begin_, buffer_count_ * buffer_size_);
+    msync(file_header_, FILE_HEADER_SIZE, MS_SYNC);
+    munmap(file_header_, FILE_HEADER_SIZE);
+    if (ftruncate(file_fd_, size) != 0) perror("ftruncate");
+    close(file_fd_);
+  }
+
+  // Making the next ring buffer free, all other buffers are pending if the next one is not free.
+  // Depending on the back-pressure policy waits for the reader to release the buffer,
+  // or overwrites the oldest pending buffer if the reader has not started it yet and
+  // it is not requested for the flight recorder dump.
+  // Returns false if the new records have to be dropped.
+  bool wait_buffer(const bool& block) {
+    bool ret = true;
+    PTHREAD_CALL(pthread_mutex_lock(&read_mutex_));
+    if ((write_index_ + 1 - read_index_) >= buffer_count_) {
+      if ((block && !flight_recorder_) || (policy_ == ROCTRACER_POOL_MODE_BLOCK)) {
+        ++wait_count_;
+        while ((write_index_ + 1 - read_index_) >= buffer_count_) {
+          PTHREAD_CALL(pthread_cond_wait(&free_cond_, &read_mutex_));
+        }
+      } else if ((policy_ == ROCTRACER_POOL_MODE_OVERWRITE_OLDEST) && (is_reading_ == false) &&
+                 (read_index_ >= dump_index_)) {
+        const buffer_t* buffer = &buffer_arr_[read_index_ % buffer_count_];
+        dropped_count_.fetch_add(buffer->count, std::memory_order_relaxed);
+        ++read_index_;
+      } else {
+        ret = false;
+      }
+    }
+    PTHREAD_CALL(pthread_mutex_unlock(&read_mutex_));
+    return ret;
+  }
+
+  // Passing the current ring buffer to the reader
+  void submit_buffer(const char* data_begin, const char* data_end, const uint64_t& count) {
+    PTHREAD_CALL(pthread_mutex_lock(&read_mutex_));
+    buffer_t* buffer = &buffer_arr_[write_index_ % buffer_count_];
+    buffer->begin = data_begin;
+    buffer->end = data_end;
+    buffer->count = count;
+    ++write_index_;
+    PTHREAD_CALL(pthread_cond_signal(&read_cond_));
+    PTHREAD_CALL(pthread_mutex_unlock(&read_mutex_));
+  }
+
+  // Waiting for the reader to pass the given index, called under the read lock
+  bool wait_reader(const uint64_t& index, const uint32_t& timeout) {
+    if (timeout == TIMEOUT_INFINITE) {
+      while (read_index_ < index) {
+        PTHREAD_CALL(pthread_cond_wait(&free_cond_, &read_mutex_));
+      }
+      return true;
+    }
+
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (timeout % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_sec += 1;
+      deadline.tv_nsec -= 1000000000;
+    }
+    while (read_index_ < index) {
+      const int status = pthread_cond_timedwait(&free_cond_, &read_mutex_, &deadline);
+      if (status == ETIMEDOUT) break;
+      PTHREAD_CALL(status);
+    }
+    return (read_index_ >= index);
   }
 
-  void spawn_reader(const char* data_begin, const char* data_end) {
-    sync_reader(&consumer_arg_);
+  // Closing the reader, the submitted buffers are drained in the drain timeout.
+  // On the timeout the reader stops after the current callback and the not read records are dropped.
+  void close_reader(const uint64_t& index) {
     PTHREAD_CALL(pthread_mutex_lock(&read_mutex_));
-    consumer_arg_.set(this, data_begin, data_end, true);
+    stop_ = true;
     PTHREAD_CALL(pthread_cond_signal(&read_cond_));
+    if (wait_reader(index, drain_timeout_) == false) {
+      drain_abort_.store(true);
+      fprintf(stderr, "ROCTracer: pool drain timeout(%ums), %lu buffers not read\n",
+        drain_timeout_, (unsigned long)(index - read_index_));
+    }
     PTHREAD_CALL(pthread_mutex_unlock(&read_mutex_));
+    PTHREAD_CALL(pthread_join(consumer_thread_, NULL));
+  }
+
+  // Reader has a buffer to read, the flight recorder buffers are read only if requested for the dump
+  bool reader_ready() const {
+    return (read_index_ != write_index_) && (!flight_recorder_ || (read_index_ < dump_index_));
+  }
+
+  static void* reader_fun(void* arg) {
+    roctracer::MemoryPool* obj = reinterpret_cast<roctracer::MemoryPool*>(arg);
+
+    while (1) {
+      PTHREAD_CALL(pthread_mutex_lock(&(obj->read_mutex_)));
+      while (!obj->reader_ready() && !obj->stop_) {
+        PTHREAD_CALL(pthread_cond_wait(&(obj->read_cond_), &(obj->read_mutex_)));
+      }
+      if (!obj->reader_ready() || obj->drain_abort_.load()) {
+        for (uint64_t i = obj->read_index_; i < obj->write_index_; ++i) {
+          obj->dropped_count_.fetch_add(obj->buffer_arr_[i % obj->buffer_count_].count, std::memory_order_relaxed);
+        }
+        PTHREAD_CALL(pthread_mutex_unlock(&(obj->read_mutex_)));
+        break;
+      }
+      const uint64_t index = obj->read_index_;
+      const buffer_t buffer = obj->buffer_arr_[index % obj->buffer_count_];
+      obj->is_reading_ = true;
+      PTHREAD_CALL(pthread_mutex_unlock(&(obj->read_mutex_)));
+
+      // The buffer stays pending while the callback is running
+      if (obj->chunk_mode_) obj->read_chunks(index);
+      else if (obj->read_callback_fun_ != NULL) obj->read_callback_fun_(buffer.begin, buffer.end, obj->read_callback_arg_);
+      if (obj->file_mode_) obj->commit_file_buffer(index, buffer);
+
+      PTHREAD_CALL(pthread_mutex_lock(&(obj->read_mutex_)));
+      obj->is_reading_ = false;
+      ++(obj->read_index_);
+      PTHREAD_CALL(pthread_cond_broadcast(&(obj->free_cond_)));
+      PTHREAD_CALL(pthread_mutex_unlock(&(obj->read_mutex_)));
+    }
+
+    return NULL;
   }
 
   // pool allocator
@@ -189,20 +796,66 @@ class MemoryPool {
 
   // Pool definition
   size_t buffer_size_;
+  uint32_t buffer_count_;
   char* pool_begin_;
   char* pool_end_;
   char* buffer_begin_;
   char* buffer_end_;
   char* write_ptr_;
+  uint64_t write_count_;
   mutex_t write_mutex_;
 
+  // Ring of the submitted buffers, the buffers from the read index to the write one are pending,
+  // guarded by the read mutex
+  buffer_t* buffer_arr_;
+  uint64_t write_index_;
+  uint64_t read_index_;
+  bool is_reading_;
+  uint64_t wait_count_;
+  uint64_t dump_index_;
+
+  // Reader close protocol, the reader drains the submitted buffers and exits
+  bool stop_;
+  std::atomic<bool> drain_abort_;
+  uint32_t drain_timeout_;
+
+  // Back-pressure policy and the dropped records counter
+  uint32_t policy_;
+  std::atomic<uint64_t> dropped_count_;
+
+  // Framed variable length records mode
+  bool var_mode_;
+
+  // File-backed pool
+  bool file_mode_;
+  int file_fd_;
+  roctracer_pool_file_header_t* file_header_;
+
+  // Per-thread chunks
+  bool chunk_mode_;
+  size_t chunk_size_;
+  uint32_t chunk_count_;
+  chunk_t* chunk_arr_;
+  uint32_t pool_id_;
+  uint64_t gen_wrap_;
+  std::atomic<uint64_t> chunk_state_;
+
+  // Flight recorder mode and the dump triggers
+  bool flight_recorder_;
+  roctracer_trigger_callback_t trigger_fun_;
+  void* trigger_arg_;
+  int dump_signal_;
+  sem_t dump_sem_;
+  std::atomic<bool> dump_stop_;
+  pthread_t dump_thread_;
+
   // Consuming read thread
   roctracer_buffer_callback_t read_callback_fun_;
   void* read_callback_arg_;
-  consumer_arg_t consumer_arg_;
   pthread_t consumer_thread_;
   pthread_mutex_t read_mutex_;
   pthread_cond_t read_cond_;
+  pthread_cond_t free_cond_;
 };
 
 }  // namespace roctracer
@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SRC_CORE_RECORD_STACK_H_
+#define SRC_CORE_RECORD_STACK_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace roctracer {
+
+// Stack of the in-flight API records, one per thread.
+// The records are reused, the pushed record is not initialized.
+// The nesting deeper than the inline capacity grows into the heap blocks of the same capacity,
+// the blocks are kept for reuse and the records never move while pushed.
+template <class Record, uint32_t Capacity>
+class RecordStack {
+  public:
+  RecordStack() : size_(0) {}
+
+  ~RecordStack() {
+    for (Record* block : blocks_) delete[] block;
+  }
+
+  bool empty() const { return size_ == 0; }
+
+  Record* push() {
+    if (size_ >= Capacity) {
+      const uint32_t index = size_ - Capacity;
+      if ((index / Capacity) == blocks_.size()) blocks_.push_back(new Record[Capacity]);
+    }
+    return at(size_++);
+  }
+
+  Record& top() { return *at(size_ - 1); }
+
+  void pop() { size_ -= 1; }
+
+  private:
+  Record* at(const uint32_t& pos) {
+    if (pos < Capacity) return &(data_[pos]);
+    const uint32_t index = pos - Capacity;
+    return &(blocks_[index / Capacity][index % Capacity]);
+  }
+
+  Record data_[Capacity];
+  uint32_t size_;
+  std::vector<Record*> blocks_;
+};
+
+}  // namespace roctracer
+
+#endif  // SRC_CORE_RECORD_STACK_H_
@@ -41,15 +41,22 @@ THE SOFTWARE.
 #include <mutex>
 #include <stack>
 
+#include "core/correlation_id_map.h"
+#include "core/global_counter.h"
 #include "core/journal.h"
 #include "core/loader.h"
 #include "core/memory_pool.h"
+#include "core/record_stack.h"
 #include "core/trace_buffer.h"
 #include "proxy/tracker.h"
 #include "ext/hsa_rt_utils.hpp"
 #include "util/exception.h"
+#include "util/fast_clock.h"
 #include "util/hsa_rsrc_factory.h"
+#include "util/huge_page_allocator.h"
 #include "util/logger.h"
+#include "util/name_table.h"
+#include "util/thread_ids.h"
 
 #include "proxy/hsa_queue.h"
 #include "proxy/intercept_queue.h"
@@ -105,6 +112,7 @@ mark_api_callback_t* mark_api_callback_ptr = NULL;
 namespace rocprofiler {
 decltype(hsa_queue_create)* hsa_queue_create_fn;
 decltype(hsa_queue_destroy)* hsa_queue_destroy_fn;
+decltype(hsa_executable_destroy)* hsa_executable_destroy_fn;
 
 decltype(hsa_signal_store_relaxed)* hsa_signal_store_relaxed_fn;
 decltype(hsa_signal_store_relaxed)* hsa_signal_store_screlease_fn;
@@ -131,6 +139,7 @@ void SaveHsaApi(::HsaApiTable* table) {
   kHsaApiTable = table;
   hsa_queue_create_fn = table->core_->hsa_queue_create_fn;
   hsa_queue_destroy_fn = table->core_->hsa_queue_destroy_fn;
+  hsa_executable_destroy_fn = table->core_->hsa_executable_destroy_fn;
 
   hsa_signal_store_relaxed_fn = table->core_->hsa_signal_store_relaxed_fn;
   hsa_signal_store_screlease_fn = table->core_->hsa_signal_store_screlease_fn;
@@ -151,6 +160,7 @@ void RestoreHsaApi() {
   ::HsaApiTable* table = kHsaApiTable;
   table->core_->hsa_queue_create_fn = hsa_queue_create_fn;
   table->core_->hsa_queue_destroy_fn = hsa_queue_destroy_fn;
+  table->core_->hsa_executable_destroy_fn = hsa_executable_destroy_fn;
 
   table->core_->hsa_signal_store_relaxed_fn = hsa_signal_store_relaxed_fn;
   table->core_->hsa_signal_store_screlease_fn = hsa_signal_store_screlease_fn;
@@ -176,6 +186,10 @@ typedef decltype(roctracer_enable_op_callback)* roctracer_enable_op_callback_t;
 typedef decltype(roctracer_disable_op_callback)* roctracer_disable_op_callback_t;
 typedef decltype(roctracer_enable_op_activity)* roctracer_enable_op_activity_t;
 typedef decltype(roctracer_disable_op_activity)* roctracer_disable_op_activity_t;
+typedef decltype(roctracer_enable_domain_callback)* roctracer_enable_domain_callback_t;
+typedef decltype(roctracer_disable_domain_callback)* roctracer_disable_domain_callback_t;
+typedef decltype(roctracer_enable_domain_activity)* roctracer_enable_domain_activity_t;
+typedef decltype(roctracer_disable_domain_activity)* roctracer_disable_domain_activity_t;
 
 struct cb_journal_data_t {
   roctracer_rtapi_callback_t callback;
@@ -190,28 +204,42 @@ struct act_journal_data_t {
 typedef Journal<act_journal_data_t> ActJournal;
 ActJournal* act_journal;
 
-template <class T, class F>
+template <class T, class F, class D>
 struct journal_functor_t {
   typedef typename T::record_t record_t;
+  typedef decltype(record_t::data) data_t;
   F f_;
-  journal_functor_t(F f) : f_(f) {}
+  D d_;
+  journal_functor_t(F f, D d) : f_(f), d_(d) {}
   bool fun(const record_t& record) {
     f_((activity_domain_t)record.domain, record.op);
     return true;
   }
+  bool fun_domain(const uint32_t& domain, const data_t&) {
+    d_((activity_domain_t)domain);
+    return true;
+  }
 };
-typedef journal_functor_t<CbJournal, roctracer_enable_op_callback_t> cb_en_functor_t;
-typedef journal_functor_t<CbJournal, roctracer_disable_op_callback_t> cb_dis_functor_t;
-typedef journal_functor_t<ActJournal, roctracer_enable_op_activity_t> act_en_functor_t;
-typedef journal_functor_t<ActJournal, roctracer_disable_op_activity_t> act_dis_functor_t;
+typedef journal_functor_t<CbJournal, roctracer_enable_op_callback_t, roctracer_enable_domain_callback_t> cb_en_functor_t;
+typedef journal_functor_t<CbJournal, roctracer_disable_op_callback_t, roctracer_disable_domain_callback_t> cb_dis_functor_t;
+typedef journal_functor_t<ActJournal, roctracer_enable_op_activity_t, roctracer_enable_domain_activity_t> act_en_functor_t;
+typedef journal_functor_t<ActJournal, roctracer_disable_op_activity_t, roctracer_disable_domain_activity_t> act_dis_functor_t;
 template<> bool cb_en_functor_t::fun(const cb_en_functor_t::record_t& record) {
   f_((activity_domain_t)record.domain, record.op, record.data.callback, record.data.user_data);
   return true;
 }
+template<> bool cb_en_functor_t::fun_domain(const uint32_t& domain, const cb_en_functor_t::data_t& data) {
+  d_((activity_domain_t)domain, data.callback, data.user_data);
+  return true;
+}
 template<> bool act_en_functor_t::fun(const act_en_functor_t::record_t& record) {
   f_((activity_domain_t)record.domain, record.op, record.data.pool);
   return true;
 }
+template<> bool act_en_functor_t::fun_domain(const uint32_t& domain, const act_en_functor_t::data_t& data) {
+  d_((activity_domain_t)domain, data.pool);
+  return true;
+}
 
 void hsa_async_copy_handler(::proxy::Tracker::entry_t* entry);
 void hsa_kernel_handler(::proxy::Tracker::entry_t* entry);
@@ -219,7 +247,7 @@ TraceBuffer<trace_entry_t>::flush_prm_t trace_buffer_prm[] = {
   {COPY_ENTRY_TYPE, hsa_async_copy_handler},
   {KERNEL_ENTRY_TYPE, hsa_kernel_handler}
 };
-TraceBuffer<trace_entry_t> trace_buffer("HSA GPU", 0x200000, trace_buffer_prm, 2);
+TraceBuffer<trace_entry_t> trace_buffer("HSA GPU", 0x100000, trace_buffer_prm, 2);
 
 namespace hsa_support {
 // callbacks table
@@ -247,22 +275,9 @@ roctracer_status_t GetExcStatus(const std::exception& e) {
   return (roctracer_exc_ptr) ? static_cast<roctracer_status_t>(roctracer_exc_ptr->status()) : ROCTRACER_STATUS_ERROR;
 }
 
-class GlobalCounter {
-  public:
-  typedef std::mutex mutex_t;
-  typedef uint64_t counter_t;
-
-  static counter_t Increment() {
-    std::lock_guard<mutex_t> lock(mutex_);
-    return ++counter_;
-  }
-
-  private:
-  static mutex_t mutex_;
-  static counter_t counter_;
-};
-GlobalCounter::mutex_t GlobalCounter::mutex_;
-GlobalCounter::counter_t GlobalCounter::counter_ = 0;
+std::atomic<GlobalCounter::counter_t> GlobalCounter::counter_(0);
+thread_local GlobalCounter::counter_t GlobalCounter::next_ = 0;
+thread_local GlobalCounter::counter_t GlobalCounter::end_ = 0;
 
 // Records storage
 struct roctracer_api_data_t {
@@ -276,28 +291,32 @@ struct record_pair_t {
   roctracer_api_data_t data;
   record_pair_t() {};
 };
-static thread_local std::stack<record_pair_t> record_pair_stack;
+// Inline nesting depth of the traced HIP API calls, the deeper calls use the heap
+static const uint32_t RECORD_STACK_CAPACITY = 32;
+static thread_local RecordStack<record_pair_t, RECORD_STACK_CAPACITY> record_pair_stack;
 
 // Correlation id storage
 static thread_local activity_correlation_id_t correlation_id_tls = 0;
-typedef std::map<activity_correlation_id_t, activity_correlation_id_t> correlation_id_map_t;
-typedef std::mutex correlation_id_mutex_t;
-correlation_id_map_t* correlation_id_map = NULL;
-correlation_id_mutex_t correlation_id_mutex;
+CorrelationIdMap<> correlation_id_map;
 
 static thread_local std::stack<activity_correlation_id_t> external_id_stack;
 
 static inline void CorrelationIdRegistr(const activity_correlation_id_t& correlation_id) {
-  std::lock_guard<correlation_id_mutex_t> lck(correlation_id_mutex);
-  if (correlation_id_map == NULL) correlation_id_map = new correlation_id_map_t;
-  const auto ret = correlation_id_map->insert({correlation_id, correlation_id_tls});
-  if (ret.second == false) EXC_ABORT(ROCTRACER_STATUS_ERROR, "HCC activity id is not unique(" << correlation_id << ")");
+  const bool ret = correlation_id_map.Insert(correlation_id, correlation_id_tls);
+  if (ret == false) EXC_ABORT(ROCTRACER_STATUS_ERROR, "HCC activity id is not unique(" << correlation_id << ")");
 }
 
 static inline activity_correlation_id_t CorrelationIdLookup(const activity_correlation_id_t& correlation_id) {
-  auto it = correlation_id_map->find(correlation_id);
-  if (it == correlation_id_map->end()) EXC_ABORT(ROCTRACER_STATUS_ERROR, "HCC activity id lookup failed(" << correlation_id << ")");
-  return it->second;
+  activity_correlation_id_t value = 0;
+  const bool ret = correlation_id_map.Lookup(correlation_id, &value);
+  if (ret == false) EXC_ABORT(ROCTRACER_STATUS_ERROR, "HCC activity id lookup failed(" << correlation_id << ")");
+  return value;
+}
+
+// Host timestamp, the process fast clock is calibrated on the roctracer load
+static inline uint64_t HostTimestampNs(const hsa_rt_utils::Timer& timer) {
+  const ::util::FastClock* clock = ::util::FastClock::Instance();
+  return (clock != NULL) ? clock->timestamp_ns() : timer.timestamp_ns();
 }
 
 void* HIP_SyncActivityCallback(
@@ -324,18 +343,19 @@ void* HIP_SyncActivityCallback(
     // Allocating a record if NULL passed
     if (record == NULL) {
       if (data != NULL) EXC_ABORT(ROCTRACER_STATUS_ERROR, "ActivityCallback enter: record is NULL");
-      record_pair_stack.push({});
-      auto& top = record_pair_stack.top();
-      record = &(top.record);
-      data = &(top.data.hip);
+      record_pair_t* top = record_pair_stack.push();
+      record = &(top->record);
+      *record = {};
+      data = &(top->data.hip);
       data_ptr = const_cast<hip_api_data_t*>(data);
       data_ptr->phase = phase;
+      data_ptr->correlation_id = 0;
     }
 
     // Filing record info
     record->domain = ACTIVITY_DOMAIN_HIP_API;
     record->op = op_id;
-    record->begin_ns = timer.timestamp_ns();
+    record->begin_ns = HostTimestampNs(timer);
 
     // Correlation ID generating
     uint64_t correlation_id = data->correlation_id;
@@ -360,9 +380,9 @@ void* HIP_SyncActivityCallback(
     }
 
     // Filing record info
-    record->end_ns = timer.timestamp_ns();
-    record->process_id = syscall(__NR_getpid);
-    record->thread_id = syscall(__NR_gettid);
+    record->end_ns = HostTimestampNs(timer);
+    record->process_id = util::ThreadIds::Pid();
+    record->thread_id = util::ThreadIds::Tid();
 
     if (external_id_stack.empty() == false) {
       roctracer_record_t ext_record{};
@@ -432,7 +452,7 @@ void hsa_kernel_handler(::proxy::Tracker::entry_t* entry) {
     //::util::HsaRsrcFactory::Instance().GetAgentInfo(entry->agent)->dev_index,
     entry->dev_index,
     entry->kernel.tid,
-    entry->kernel.name,
+    util::NameTable::Instance()->Demangled(entry->kernel.name_id),
     entry->dispatch,
     entry->begin,
     entry->end,
@@ -486,7 +506,8 @@ hsa_status_t hsa_amd_memory_async_copy_interceptor(
     status = hsa_amd_memory_async_copy_fn(dst, dst_agent, src,
                                           src_agent, size, num_dep_signals,
                                           dep_signals, entry->signal);
-    if (status != HSA_STATUS_SUCCESS) ::proxy::Tracker::Disable(entry);
+    if (status == HSA_STATUS_SUCCESS) ::proxy::Tracker::Track(entry);
+    else ::proxy::Tracker::Disable(entry);
   }
   else
   {
@@ -511,7 +532,8 @@ hsa_status_t hsa_amd_memory_async_copy_rect_interceptor(
                                                src_offset, range, copy_agent,
                                                dir, num_dep_signals, dep_signals,
                                                entry->signal);
-    if (status != HSA_STATUS_SUCCESS) ::proxy::Tracker::Disable(entry);
+    if (status == HSA_STATUS_SUCCESS) ::proxy::Tracker::Track(entry);
+    else ::proxy::Tracker::Disable(entry);
   }
   else
   {
@@ -525,6 +547,8 @@ hsa_status_t hsa_amd_memory_async_copy_rect_interceptor(
 
 util::Logger::mutex_t util::Logger::mutex_;
 std::atomic<util::Logger*> util::Logger::instance_{};
+::util::FastClock::mutex_t ::util::FastClock::mutex_;
+std::atomic<::util::FastClock*> ::util::FastClock::instance_{};
 MemoryPool* memory_pool = NULL;
 typedef std::recursive_mutex memory_pool_mutex_t;
 memory_pool_mutex_t memory_pool_mutex;
@@ -532,6 +556,9 @@ memory_pool_mutex_t memory_pool_mutex;
 
 LOADER_INSTANTIATE();
 
+::proxy::Tracker::signal_pools_t* ::proxy::Tracker::signal_pools_ = new ::proxy::Tracker::signal_pools_t;
+::proxy::Tracker::harvesters_t* ::proxy::Tracker::harvesters_ = ::proxy::Tracker::CreateHarvesters();
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // Public library methods
 //
@@ -683,14 +710,58 @@ PUBLIC_API roctracer_status_t roctracer_enable_op_callback(
   API_METHOD_SUFFIX
 }
 
+// Enable runtime API callbacks for all ops of the domain
+static roctracer_status_t roctracer_enable_callback_domain_fun(
+    roctracer_domain_t domain,
+    roctracer_rtapi_callback_t callback,
+    void* user_data)
+{
+  switch (domain) {
+#ifdef KFD_WRAPPER
+    case ACTIVITY_DOMAIN_KFD_API: {
+      const bool succ = roctracer::KfdLoader::Instance().RegisterApiCallbackAll((void*)callback, user_data);
+      if (succ == false) EXC_RAISING(ROCTRACER_STATUS_ERROR, "KFD RegisterApiCallbackAll error");
+      break;
+    }
+#endif
+    case ACTIVITY_DOMAIN_HSA_OPS: break;
+    case ACTIVITY_DOMAIN_HSA_API: {
+      roctracer::hsa_support::cb_table.set_all(callback, user_data);
+      break;
+    }
+    case ACTIVITY_DOMAIN_HCC_OPS: break;
+    case ACTIVITY_DOMAIN_ROCTX: {
+      if (roctracer::RocTxLoader::Instance().Enabled()) {
+        const bool suc = roctracer::RocTxLoader::Instance().RegisterApiCallbackAll((void*)callback, user_data);
+        if (suc == false) EXC_RAISING(ROCTRACER_STATUS_ROCTX_ERR, "roctxRegisterApiCallbackAll failed");
+      }
+      break;
+    }
+    default: {
+      // The HIP runtime registers the callbacks per op, the per op function rejects the bad domains
+      const uint32_t op_num = get_op_num(domain);
+      for (uint32_t op = 0; op < op_num; op++) roctracer_enable_callback_fun(domain, op, callback, user_data);
+    }
+  }
+  return ROCTRACER_STATUS_SUCCESS;
+}
+
+static void roctracer_enable_callback_domain_impl(
+    uint32_t domain,
+    roctracer_rtapi_callback_t callback,
+    void* user_data)
+{
+    roctracer::cb_journal->registr_domain(domain, get_op_num(domain), {callback, user_data});
+    roctracer_enable_callback_domain_fun((roctracer_domain_t)domain, callback, user_data);
+}
+
 PUBLIC_API roctracer_status_t roctracer_enable_domain_callback(
     roctracer_domain_t domain,
     roctracer_rtapi_callback_t callback,
     void* user_data)
 {
   API_METHOD_PREFIX
-  const uint32_t op_num = get_op_num(domain);
-  for (uint32_t op = 0; op < op_num; op++) roctracer_enable_callback_impl(domain, op, callback, user_data);
+  roctracer_enable_callback_domain_impl(domain, callback, user_data);
   API_METHOD_SUFFIX
 }
 
@@ -699,10 +770,7 @@ PUBLIC_API roctracer_status_t roctracer_enable_callback(
     void* user_data)
 {
   API_METHOD_PREFIX
-  for (uint32_t domain = 0; domain < ACTIVITY_DOMAIN_NUMBER; domain++) {
-    const uint32_t op_num = get_op_num(domain);
-    for (uint32_t op = 0; op < op_num; op++) roctracer_enable_callback_impl(domain, op, callback, user_data);
-  }
+  for (uint32_t domain = 0; domain < ACTIVITY_DOMAIN_NUMBER; domain++) roctracer_enable_callback_domain_impl(domain, callback, user_data);
   API_METHOD_SUFFIX
 }
 
@@ -757,22 +825,55 @@ PUBLIC_API roctracer_status_t roctracer_disable_op_callback(
   API_METHOD_SUFFIX
 }
 
+// Disable runtime API callbacks for all ops of the domain
+static roctracer_status_t roctracer_disable_callback_domain_fun(
+    roctracer_domain_t domain)
+{
+  switch (domain) {
+#ifdef KFD_WRAPPER
+    case ACTIVITY_DOMAIN_KFD_API: {
+      const bool succ = roctracer::KfdLoader::Instance().RemoveApiCallbackAll();
+      if (succ == false) EXC_RAISING(ROCTRACER_STATUS_ERROR, "KFD RemoveApiCallbackAll error");
+      break;
+    }
+#endif
+    case ACTIVITY_DOMAIN_HSA_OPS: break;
+    case ACTIVITY_DOMAIN_HSA_API: break;
+    case ACTIVITY_DOMAIN_HCC_OPS: break;
+    case ACTIVITY_DOMAIN_ROCTX: {
+      if (roctracer::RocTxLoader::Instance().Enabled()) {
+        const bool suc = roctracer::RocTxLoader::Instance().RemoveApiCallbackAll();
+        if (suc == false) EXC_RAISING(ROCTRACER_STATUS_ROCTX_ERR, "roctxRemoveApiCallbackAll failed");
+      }
+      break;
+    }
+    default: {
+      const uint32_t op_num = get_op_num(domain);
+      for (uint32_t op = 0; op < op_num; op++) roctracer_disable_callback_fun(domain, op);
+    }
+  }
+  return ROCTRACER_STATUS_SUCCESS;
+}
+
+static void roctracer_disable_callback_domain_impl(
+    uint32_t domain)
+{
+    roctracer::cb_journal->remove_domain(domain);
+    roctracer_disable_callback_domain_fun((roctracer_domain_t)domain);
+}
+
 PUBLIC_API roctracer_status_t roctracer_disable_domain_callback(
     roctracer_domain_t domain)
 {
   API_METHOD_PREFIX
-  const uint32_t op_num = get_op_num(domain);
-  for (uint32_t op = 0; op < op_num; op++) roctracer_disable_callback_impl(domain, op);
+  roctracer_disable_callback_domain_impl(domain);
   API_METHOD_SUFFIX
 }
 
 PUBLIC_API roctracer_status_t roctracer_disable_callback()
 {
   API_METHOD_PREFIX
-  for (uint32_t domain = 0; domain < ACTIVITY_DOMAIN_NUMBER; domain++) {
-    const uint32_t op_num = get_op_num(domain);
-    for (uint32_t op = 0; op < op_num; op++) roctracer_disable_callback_impl(domain, op);
-  }
+  for (uint32_t domain = 0; domain < ACTIVITY_DOMAIN_NUMBER; domain++) roctracer_disable_callback_domain_impl(domain);
   API_METHOD_SUFFIX
 }
 
@@ -784,6 +885,11 @@ PUBLIC_API roctracer_pool_t* roctracer_default_pool(roctracer_pool_t* pool) {
   return p;
 }
 
+// Built-in huge pages allocator
+PUBLIC_API void roctracer_huge_page_allocator(char** ptr, size_t size, void* arg) {
+  roctracer::util::HugePageAllocator::allocator(ptr, size, arg);
+}
+
 // Open memory pool
 PUBLIC_API roctracer_status_t roctracer_open_pool(
     const roctracer_properties_t* properties,
@@ -812,6 +918,38 @@ PUBLIC_API roctracer_status_t roctracer_close_pool(roctracer_pool_t* pool) {
   API_METHOD_SUFFIX
 }
 
+// Write activity record with inline payload
+PUBLIC_API roctracer_status_t roctracer_write_record(
+    const activity_record_t* record,
+    const void* payload,
+    uint32_t payload_size,
+    roctracer_pool_t* pool)
+{
+  API_METHOD_PREFIX
+  if (record == NULL) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "record is NULL");
+  if ((payload == NULL) && (payload_size != 0)) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "payload is NULL");
+  if (pool == NULL) pool = roctracer_default_pool();
+  if (pool == NULL) EXC_RAISING(ROCTRACER_STATUS_ERROR, "default pool is not set");
+  roctracer::MemoryPool* memory_pool = reinterpret_cast<roctracer::MemoryPool*>(pool);
+  memory_pool->WriteVar(*record, payload, payload_size);
+  API_METHOD_SUFFIX
+}
+
+// Return memory pool statistics
+PUBLIC_API roctracer_status_t roctracer_get_pool_stats(
+    roctracer_pool_stats_t* stats,
+    roctracer_pool_t* pool)
+{
+  API_METHOD_PREFIX
+  if (stats == NULL) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "stats is NULL");
+  if (pool == NULL) pool = roctracer_default_pool();
+  if (pool == NULL) EXC_RAISING(ROCTRACER_STATUS_ERROR, "default pool is not set");
+  roctracer::MemoryPool* memory_pool = reinterpret_cast<roctracer::MemoryPool*>(pool);
+  stats->buffer_wait_count = memory_pool->WaitCount();
+  stats->dropped_record_count = memory_pool->DroppedCount();
+  API_METHOD_SUFFIX
+}
+
 // Enable activity records logging
 static roctracer_status_t roctracer_enable_activity_fun(
     roctracer_domain_t domain,
@@ -868,13 +1006,38 @@ PUBLIC_API roctracer_status_t roctracer_enable_op_activity(
   API_METHOD_SUFFIX
 }
 
+// Enable activity records logging for all ops of the domain
+static roctracer_status_t roctracer_enable_activity_domain_fun(
+    roctracer_domain_t domain,
+    roctracer_pool_t* pool)
+{
+  switch (domain) {
+    case ACTIVITY_DOMAIN_HSA_API: break;
+    case ACTIVITY_DOMAIN_KFD_API: break;
+    case ACTIVITY_DOMAIN_ROCTX: break;
+    default: {
+      // The runtimes enable the activity per op, the per op function rejects the bad domains
+      const uint32_t op_num = get_op_num(domain);
+      for (uint32_t op = 0; op < op_num; op++) roctracer_enable_activity_fun(domain, op, pool);
+    }
+  }
+  return ROCTRACER_STATUS_SUCCESS;
+}
+
+static void roctracer_enable_activity_domain_impl(
+    uint32_t domain,
+    roctracer_pool_t* pool)
+{
+    roctracer::act_journal->registr_domain(domain, get_op_num(domain), {pool});
+    roctracer_enable_activity_domain_fun((roctracer_domain_t)domain, pool);
+}
+
 PUBLIC_API roctracer_status_t roctracer_enable_domain_activity(
     roctracer_domain_t domain,
     roctracer_pool_t* pool)
 {
   API_METHOD_PREFIX
-  const uint32_t op_num = get_op_num(domain);
-  for (uint32_t op = 0; op < op_num; op++) roctracer_enable_activity_impl(domain, op, pool);
+  roctracer_enable_activity_domain_impl(domain, pool);
   API_METHOD_SUFFIX
 }
 
@@ -882,10 +1045,7 @@ PUBLIC_API roctracer_status_t roctracer_enable_activity(
     roctracer_pool_t* pool)
 {
   API_METHOD_PREFIX
-  for (uint32_t domain = 0; domain < ACTIVITY_DOMAIN_NUMBER; domain++) {
-    const uint32_t op_num = get_op_num(domain);
-    for (uint32_t op = 0; op < op_num; op++) roctracer_enable_activity_impl(domain, op, pool);
-  }
+  for (uint32_t domain = 0; domain < ACTIVITY_DOMAIN_NUMBER; domain++) roctracer_enable_activity_domain_impl(domain, pool);
   API_METHOD_SUFFIX
 }
 
@@ -936,22 +1096,41 @@ PUBLIC_API roctracer_status_t roctracer_disable_op_activity(
   API_METHOD_SUFFIX
 }
 
+// Disable activity records logging for all ops of the domain
+static roctracer_status_t roctracer_disable_activity_domain_fun(
+    roctracer_domain_t domain)
+{
+  switch (domain) {
+    case ACTIVITY_DOMAIN_HSA_API: break;
+    case ACTIVITY_DOMAIN_KFD_API: break;
+    case ACTIVITY_DOMAIN_ROCTX: break;
+    default: {
+      const uint32_t op_num = get_op_num(domain);
+      for (uint32_t op = 0; op < op_num; op++) roctracer_disable_activity_fun(domain, op);
+    }
+  }
+  return ROCTRACER_STATUS_SUCCESS;
+}
+
+static void roctracer_disable_activity_domain_impl(
+    uint32_t domain)
+{
+    roctracer::act_journal->remove_domain(domain);
+    roctracer_disable_activity_domain_fun((roctracer_domain_t)domain);
+}
+
 PUBLIC_API roctracer_status_t roctracer_disable_domain_activity(
     roctracer_domain_t domain)
 {
   API_METHOD_PREFIX
-  const uint32_t op_num = get_op_num(domain);
-  for (uint32_t op = 0; op < op_num; op++) roctracer_disable_activity_impl(domain, op);
+  roctracer_disable_activity_domain_impl(domain);
   API_METHOD_SUFFIX
 }
 
 PUBLIC_API roctracer_status_t roctracer_disable_activity()
 {
   API_METHOD_PREFIX
-  for (uint32_t domain = 0; domain < ACTIVITY_DOMAIN_NUMBER; domain++) {
-    const uint32_t op_num = get_op_num(domain);
-    for (uint32_t op = 0; op < op_num; op++) roctracer_disable_activity_impl(domain, op);
-  }
+  for (uint32_t domain = 0; domain < ACTIVITY_DOMAIN_NUMBER; domain++) roctracer_disable_activity_domain_impl(domain);
   API_METHOD_SUFFIX
 }
 
@@ -964,6 +1143,33 @@ PUBLIC_API roctracer_status_t roctracer_flush_activity(roctracer_pool_t* pool) {
   API_METHOD_SUFFIX
 }
 
+// Start flushing available activity records, the completion is tracked by the handle
+PUBLIC_API roctracer_status_t roctracer_flush_activity_async(
+    roctracer_flush_handle_t* handle,
+    roctracer_pool_t* pool)
+{
+  API_METHOD_PREFIX
+  if (handle == NULL) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "handle is NULL");
+  if (pool == NULL) pool = roctracer_default_pool();
+  if (pool == NULL) EXC_RAISING(ROCTRACER_STATUS_ERROR, "default pool is not set");
+  roctracer::MemoryPool* memory_pool = reinterpret_cast<roctracer::MemoryPool*>(pool);
+  handle->pool = pool;
+  handle->index = memory_pool->FlushAsync();
+  API_METHOD_SUFFIX
+}
+
+// Wait for the flush completion
+PUBLIC_API roctracer_status_t roctracer_flush_wait(
+    const roctracer_flush_handle_t* handle,
+    uint32_t timeout)
+{
+  API_METHOD_PREFIX
+  if ((handle == NULL) || (handle->pool == NULL)) EXC_RAISING(ROCTRACER_STATUS_BAD_PARAMETER, "bad flush handle");
+  roctracer::MemoryPool* memory_pool = reinterpret_cast<roctracer::MemoryPool*>(handle->pool);
+  if (memory_pool->WaitFlush(handle->index, timeout) == false) err = ROCTRACER_STATUS_BREAK;
+  API_METHOD_SUFFIX
+}
+
 // Notifies that the calling thread is entering an external API region.
 // Push an external correlation id for the calling thread.
 PUBLIC_API roctracer_status_t roctracer_activity_push_external_correlation_id(activity_correlation_id_t id) {
@@ -1002,14 +1208,14 @@ PUBLIC_API void roctracer_mark(const char* str) {
 // Start API
 PUBLIC_API void roctracer_start() {
   if (roctracer::ext_support::roctracer_start_cb) roctracer::ext_support::roctracer_start_cb();
-  roctracer::cb_journal->foreach(roctracer::cb_en_functor_t(roctracer_enable_callback_fun));
-  roctracer::act_journal->foreach(roctracer::act_en_functor_t(roctracer_enable_activity_fun));
+  roctracer::cb_journal->foreach(roctracer::cb_en_functor_t(roctracer_enable_callback_fun, roctracer_enable_callback_domain_fun));
+  roctracer::act_journal->foreach(roctracer::act_en_functor_t(roctracer_enable_activity_fun, roctracer_enable_activity_domain_fun));
 }
 
 // Stop API
 PUBLIC_API void roctracer_stop() {
-  roctracer::cb_journal->foreach(roctracer::cb_dis_functor_t(roctracer_disable_callback_fun));
-  roctracer::act_journal->foreach(roctracer::act_dis_functor_t(roctracer_disable_activity_fun));
+  roctracer::cb_journal->foreach(roctracer::cb_dis_functor_t(roctracer_disable_callback_fun, roctracer_disable_callback_domain_fun));
+  roctracer::act_journal->foreach(roctracer::act_dis_functor_t(roctracer_disable_activity_fun, roctracer_disable_activity_domain_fun));
   if (roctracer::ext_support::roctracer_stop_cb) roctracer::ext_support::roctracer_stop_cb();
 }
 
@@ -1090,6 +1296,9 @@ PUBLIC_API bool roctracer_load(HsaApiTable* table, uint64_t runtime_version, uin
   if (is_loaded) return true;
   is_loaded = true;
 
+  // Calibrating the process fast clock off the callbacks path
+  util::FastClock::Create(table->core_->hsa_system_get_info_fn);
+
   if (onload_debug) { printf("LIB roctracer_load end\n"); fflush(stdout); }
   return true;
 }
@@ -1102,6 +1311,7 @@ PUBLIC_API void roctracer_unload(bool destruct) {
   if (is_unloaded == true) return;
   is_unloaded = true;
 
+  roctracer::util::NameTable::Instance()->DemangleAll();
   roctracer::trace_buffer.Flush();
   roctracer::close_output_file(roctracer::kernel_file_handle);
   if (onload_debug) { printf("LIB roctracer_unload end\n"); fflush(stdout); }
@@ -1116,6 +1326,7 @@ PUBLIC_API bool OnLoad(HsaApiTable* table, uint64_t runtime_version, uint64_t fa
 }
 PUBLIC_API void OnUnload() {
   if (onload_debug) { printf("LIB OnUnload\n"); fflush(stdout); }
+  ::proxy::Tracker::Stop();
   roctracer_unload(false);
   if (onload_debug) { printf("LIB OnUnload end\n"); fflush(stdout); }
 }
@@ -1123,6 +1334,7 @@ PUBLIC_API void OnUnload() {
 CONSTRUCTOR_API void constructor() {
   if (onload_debug) { printf("LIB constructor\n"); fflush(stdout); }
   roctracer::util::Logger::Create();
+  roctracer::util::ThreadIds::Init();
   if (roctracer::cb_journal == NULL) roctracer::cb_journal = new roctracer::CbJournal;
   if (roctracer::act_journal == NULL) roctracer::act_journal = new roctracer::ActJournal;
   if (onload_debug) { printf("LIB constructor end\n"); fflush(stdout); }
@@ -1,12 +1,22 @@
 #ifndef SRC_CORE_TRACE_BUFFER_H_
 #define SRC_CORE_TRACE_BUFFER_H_
 
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
 #include <atomic>
+#include <hsa.h>
 #include <list>
 #include <mutex>
 #include <pthread.h>
 #include <string.h>
 #include <unistd.h>
+#include <vector>
+
+#include "core/chunk_pool.h"
+#include "util/huge_page_allocator.h"
 
 #define PTHREAD_CALL(call)                                                                         \
   do {                                                                                             \
@@ -19,10 +29,13 @@
   } while (0)
 
 namespace roctracer {
+// The not yet written entries are free, the zero value is held by the fresh zeroed
+// memory, so the new chunks don't need to be touched
 enum {
-  TRACE_ENTRY_INV = 0,
+  TRACE_ENTRY_FREE = 0,
   TRACE_ENTRY_INIT = 1,
-  TRACE_ENTRY_COMPL = 2
+  TRACE_ENTRY_COMPL = 2,
+  TRACE_ENTRY_INV = 3
 };
 
 enum {
@@ -31,27 +44,50 @@ enum {
   KERNEL_ENTRY_TYPE
 };
 
-struct trace_entry_t {
-  std::atomic<uint32_t> valid;
+static const uint32_t TRACE_ENTRY_ALIGN = 64;
+
+// Entry state handle, the states of a chunk entries are kept in a dense state map at the chunk
+// head, one byte per entry. The flush scans the map and the state stores don't write the entry
+// cache lines. The handle is bound by the trace buffer when the entry is reserved.
+class trace_state_t {
+  public:
+  void bind(std::atomic<uint8_t>* state) { state_ = state; }
+  uint32_t load(std::memory_order order = std::memory_order_seq_cst) const { return state_->load(order); }
+  void store(uint32_t state, std::memory_order order = std::memory_order_seq_cst) { state_->store(state, order); }
+
+  private:
+  std::atomic<uint8_t>* state_;
+};
+
+// The entry is two cache lines, the fields written on the submit are on the first line and
+// the fields written by the completion handler are on the second one. The submitting and
+// the completing threads don't share the entry lines, the states are in the chunk state map.
+struct alignas(TRACE_ENTRY_ALIGN) trace_entry_t {
+  // Written on submit
+  trace_state_t valid;
   uint32_t type;
+  uint32_t signal_index;                               // proxy signal pool index
   uint64_t dispatch;
-  uint64_t begin;                                      // kernel begin timestamp, ns
-  uint64_t end;                                        // kernel end timestamp, ns
-  uint64_t complete;
   hsa_agent_t agent;
-  uint32_t dev_index;
   hsa_signal_t orig;
   hsa_signal_t signal;
   union {
     struct {
     } copy;
     struct {
-      const char* name;
-      hsa_agent_t agent;
+      uint32_t name_id;                                // interned kernel name id
       uint32_t tid;
+      hsa_agent_t agent;
     } kernel;
   };
+
+  // Written on completion
+  alignas(TRACE_ENTRY_ALIGN) uint32_t dev_index;
+  uint64_t begin;                                      // kernel begin timestamp, ns
+  uint64_t end;                                        // kernel end timestamp, ns
+  uint64_t complete;
 };
+static_assert(sizeof(trace_entry_t) == 2 * TRACE_ENTRY_ALIGN, "trace_entry_t submit fields exceed the cache line");
 
 template <typename Entry>
 class TraceBuffer {
@@ -66,106 +102,226 @@ class TraceBuffer {
     callback_t fun;
   };
 
+  // Streaming flush period
+  static const uint32_t FLUSH_INTERVAL_MS = 100;
+
   TraceBuffer(const char* name, uint32_t size, flush_prm_t* flush_prm_arr, uint32_t flush_prm_count) :
     is_flushed_(false)
   {
     name_ = strdup(name);
     size_ = size;
-    data_ = allocate_fun();
-    next_ = NULL;
+    huge_pages_ = util::HugePageAllocator::Enabled();
+    chunk_pool_ = ChunkPool::Instance();
+    map_size_ = (size_ + TRACE_ENTRY_ALIGN - 1) & ~(size_t)(TRACE_ENTRY_ALIGN - 1);
+    chunk_class_ = chunk_pool_->Register(map_size_ + size_ * sizeof(Entry), huge_pages_, reset_fun);
+    data_ = next_fun(false);
     read_pointer_ = 0;
     end_pointer_ = size;
+    wrap_seq_ = 0;
+    begin_pointer_ = 0;
+    flush_pointer_ = 0;
     buf_list_.push_back(data_);
 
     flush_prm_arr_ = flush_prm_arr;
     flush_prm_count_ = flush_prm_count;
+    for (flush_prm_t* prm = flush_prm_arr_; prm < flush_prm_arr_ + flush_prm_count_; prm++) {
+      if (prm->type >= dispatch_table_.size()) dispatch_table_.resize(prm->type + 1, NULL);
+      if (dispatch_table_[prm->type] != NULL) abort_run("TraceBuffer: duplicate flush entry type");
+      dispatch_table_[prm->type] = prm->fun;
+    }
 
     PTHREAD_CALL(pthread_mutex_init(&work_mutex_, NULL));
-    PTHREAD_CALL(pthread_cond_init(&work_cond_, NULL));
-    PTHREAD_CALL(pthread_create(&work_thread_, NULL, allocate_worker, this));
+    flush_stop_ = false;
+    PTHREAD_CALL(pthread_cond_init(&flush_cond_, NULL));
+    PTHREAD_CALL(pthread_create(&flush_thread_, NULL, flush_worker, this));
   }
 
   ~TraceBuffer() {
-    PTHREAD_CALL(pthread_cancel(work_thread_));
-    void *res;
-    PTHREAD_CALL(pthread_join(work_thread_, &res));
-    if (res != PTHREAD_CANCELED) abort_run("~TraceBuffer: consumer thread wasn't stopped correctly");
-
     Flush();
+    chunk_pool_->Unregister(chunk_class_);
   }
 
 
-  Entry* GetEntry() {
-    const pointer_t pointer = read_pointer_.fetch_add(1);
-    if (pointer >= end_pointer_) wrap_buffer(pointer);
-    if (pointer >= end_pointer_) abort_run("pointer >= end_pointer_ after buffer wrap");
-    return data_ + (pointer + size_ - end_pointer_);
+  Entry* GetEntry() { return get_entry(read_pointer_.fetch_add(1)); }
+
+  // Reserving 'count' entries with one atomic add, the entries can span the chunks
+  void GetEntries(Entry** entry_arr, const uint32_t& count) {
+    const pointer_t pointer = read_pointer_.fetch_add(count);
+    for (uint32_t i = 0; i < count; ++i) entry_arr[i] = get_entry(pointer + i);
   }
 
+  // Stopping the streaming flush and flushing all remaining completed entries
   void Flush() {
+    stop_flusher();
     flush_buf();
   }
 
   private:
+  Entry* get_entry(const pointer_t pointer) {
+    if (pointer >= end_pointer_) wrap_buffer(pointer);
+
+    // Consistent current chunk snapshot, the wrap sequence is odd while wrapping
+    const uint64_t seq = wrap_seq_.load();
+    const pointer_t end_pointer = end_pointer_.load();
+    Entry* data = data_.load();
+    if (((seq & 1) == 0) && (wrap_seq_.load() == seq) && (pointer + size_ >= end_pointer)) {
+      return bind_entry(data, pointer + size_ - end_pointer);
+    }
+    return lookup_entry(pointer);
+  }
+
+  // The chunk state map precedes the chunk entries
+  std::atomic<uint8_t>* state_map(Entry* chunk) const {
+    return reinterpret_cast<std::atomic<uint8_t>*>(reinterpret_cast<char*>(chunk) - map_size_);
+  }
+
+  Entry* bind_entry(Entry* chunk, const pointer_t index) {
+    Entry* entry = chunk + index;
+    entry->valid.bind(state_map(chunk) + index);
+    return entry;
+  }
+
   void flush_buf() {
-    std::lock_guard<mutex_t> lck(mutex_);
     const bool is_flushed = is_flushed_.exchange(true, std::memory_order_acquire);
 
     if (is_flushed == false) {
-      for (flush_prm_t* prm = flush_prm_arr_; prm < flush_prm_arr_ + flush_prm_count_; prm++) {
-        uint32_t type = prm->type;
-        callback_t fun = prm->fun;
-        pointer_t pointer = 0;
-        for (Entry* ptr : buf_list_) {
-          Entry* end = ptr + size_;
-          while ((ptr < end) && (pointer < read_pointer_)) {
-            if (ptr->type == type) {
-              if (ptr->valid == TRACE_ENTRY_COMPL) {
-                fun(ptr);
-              }
-            }
-            ptr++;
-            pointer++;
-          }
+      flush_entries(true);
+    }
+  }
+
+  // Passing the completed entries to the callbacks in order starting from the flush pointer,
+  // all entry types are dispatched in one pass by the type-indexed table.
+  // The streaming flush stops at the first not completed entry, the completion watermark,
+  // the final flush skips such entries. The consumed chunks are recycled, a chunk with
+  // skipped entries is leaked as their writers or completion handlers can be in flight.
+  void flush_entries(const bool& final) {
+    std::lock_guard<mutex_t> flush_lck(flush_mutex_);
+
+    while (1) {
+      Entry* chunk = NULL;
+      bool is_last = false;
+      {
+        std::lock_guard<mutex_t> lck(mutex_);
+        chunk = buf_list_.front();
+        is_last = (buf_list_.size() == 1);
+      }
+      const pointer_t read_pointer = read_pointer_.load(std::memory_order_acquire);
+      const pointer_t chunk_end = begin_pointer_ + size_;
+      const pointer_t limit = (read_pointer < chunk_end) ? read_pointer : chunk_end;
+
+      const size_t table_size = dispatch_table_.size();
+      const callback_t* table = dispatch_table_.data();
+      Entry* ptr = chunk + (flush_pointer_ - begin_pointer_);
+      const std::atomic<uint8_t>* state = state_map(chunk) + (flush_pointer_ - begin_pointer_);
+      bool pending = false;
+      while (flush_pointer_ < limit) {
+        const uint32_t valid = state->load(std::memory_order_acquire);
+        if (valid == TRACE_ENTRY_COMPL) {
+          const uint32_t type = ptr->type;
+          if ((type < table_size) && (table[type] != NULL)) table[type](ptr);
+        } else if (valid != TRACE_ENTRY_INV) {
+          if (!final) break;
+          pending = true;
+        }
+        ptr++;
+        state++;
+        flush_pointer_++;
+      }
+
+      // The chunk is consumed, the writers moved to the next one
+      if ((flush_pointer_ == chunk_end) && !is_last) {
+        {
+          std::lock_guard<mutex_t> lck(mutex_);
+          buf_list_.pop_front();
+          if (pending) pending_list_.push_back(pending_chunk_t{begin_pointer_, chunk});
         }
+        begin_pointer_ = chunk_end;
+        if (!pending) recycle_fun(chunk);
+      } else {
+        break;
       }
     }
   }
 
-  inline Entry* allocate_fun() {
-    Entry* ptr = (Entry*) malloc(size_ * sizeof(Entry));
-    if (ptr == NULL) abort_run("TraceBuffer::allocate_fun: calloc failed");
-    //memset(ptr, 0, size_ * sizeof(Entry));
-    return ptr;
+  // Resetting the entries of a recycled chunk as free, the state map is no longer than
+  // one byte per entry size of the chunk
+  static void reset_fun(void* ptr, size_t size) {
+    const size_t map_size = (size / sizeof(Entry) + TRACE_ENTRY_ALIGN - 1) & ~(size_t)(TRACE_ENTRY_ALIGN - 1);
+    memset(ptr, TRACE_ENTRY_FREE, (map_size < size) ? map_size : size);
+  }
+
+  // Next chunk is taken from the shared chunk pool, the pool is refilled from the first wrap
+  inline Entry* next_fun(bool refill = true) {
+    return reinterpret_cast<Entry*>((char*)chunk_pool_->Acquire(chunk_class_, refill) + map_size_);
   }
 
-  static void* allocate_worker(void* arg) {
+  // Returning the consumed chunk to the shared chunk pool, all its entries were written
+  inline void recycle_fun(Entry* ptr) { chunk_pool_->Release(chunk_class_, state_map(ptr)); }
+
+  // Streaming flush worker, woken up periodically and on the buffer wrap
+  static void* flush_worker(void* arg) {
     Obj* obj = (Obj*)arg;
 
-    while (1) {
-      PTHREAD_CALL(pthread_mutex_lock(&(obj->work_mutex_)));
-      while (obj->next_ != NULL) {
-        PTHREAD_CALL(pthread_cond_wait(&(obj->work_cond_), &(obj->work_mutex_)));
+    PTHREAD_CALL(pthread_mutex_lock(&(obj->work_mutex_)));
+    while (obj->flush_stop_ == false) {
+      timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += FLUSH_INTERVAL_MS * 1000000;
+      if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000;
       }
-      obj->next_ = obj->allocate_fun();
+      const int status = pthread_cond_timedwait(&(obj->flush_cond_), &(obj->work_mutex_), &deadline);
+      if (status != ETIMEDOUT) PTHREAD_CALL(status);
+      if (obj->flush_stop_ == true) break;
+
       PTHREAD_CALL(pthread_mutex_unlock(&(obj->work_mutex_)));
+      obj->flush_entries(false);
+      PTHREAD_CALL(pthread_mutex_lock(&(obj->work_mutex_)));
     }
+    PTHREAD_CALL(pthread_mutex_unlock(&(obj->work_mutex_)));
 
     return NULL;
   }
 
+  void stop_flusher() {
+    PTHREAD_CALL(pthread_mutex_lock(&work_mutex_));
+    const bool is_stopped = flush_stop_;
+    flush_stop_ = true;
+    PTHREAD_CALL(pthread_cond_signal(&flush_cond_));
+    PTHREAD_CALL(pthread_mutex_unlock(&work_mutex_));
+    if (is_stopped == false) PTHREAD_CALL(pthread_join(flush_thread_, NULL));
+  }
+
   void wrap_buffer(const pointer_t pointer) {
     std::lock_guard<mutex_t> lck(mutex_);
-    PTHREAD_CALL(pthread_mutex_lock(&work_mutex_));
-    if (pointer >= end_pointer_) {
-      data_ = next_;
-      next_ = NULL;
-      PTHREAD_CALL(pthread_cond_signal(&work_cond_));
+    while (pointer >= end_pointer_) {
+      Entry* data = next_fun();
+      PTHREAD_CALL(pthread_cond_signal(&flush_cond_));
+      wrap_seq_.fetch_add(1);
+      data_.store(data);
       end_pointer_ += size_;
+      wrap_seq_.fetch_add(1);
       if (end_pointer_ == 0) abort_run("TraceBuffer::wrap_buffer: pointer overflow");
-      buf_list_.push_back(data_);
+      buf_list_.push_back(data);
     }
-    PTHREAD_CALL(pthread_mutex_unlock(&work_mutex_));
+  }
+
+  // Entry of a not current chunk, the chunk can't be recycled before the entry is written,
+  // the chunks skipped by the final flush are kept for the late entries
+  Entry* lookup_entry(const pointer_t pointer) {
+    std::lock_guard<mutex_t> lck(mutex_);
+    pointer_t begin = end_pointer_ - size_;
+    for (typename std::list<Entry*>::reverse_iterator it = buf_list_.rbegin(); it != buf_list_.rend(); ++it) {
+      if (pointer >= begin) return bind_entry(*it, pointer - begin);
+      begin -= size_;
+    }
+    // The late entry of a chunk skipped by the final flush
+    for (const pending_chunk_t& pending : pending_list_) {
+      if ((pointer >= pending.begin) && (pointer < pending.begin + size_)) return bind_entry(pending.chunk, pointer - pending.begin);
+    }
+    abort_run("TraceBuffer::lookup_entry: entry chunk not found");
+    return NULL;
   }
 
   void abort_run(const char* str) {
@@ -176,19 +332,38 @@ class TraceBuffer {
 
   const char* name_;
   uint32_t size_;
-  Entry* data_;
-  Entry* next_;
+  size_t map_size_;
+  bool huge_pages_;
+  ChunkPool* chunk_pool_;
+  uint32_t chunk_class_;
+  std::atomic<Entry*> data_;
   volatile std::atomic<pointer_t> read_pointer_;
   volatile std::atomic<pointer_t> end_pointer_;
+  std::atomic<uint64_t> wrap_seq_;
   std::list<Entry*> buf_list_;
+  // Chunks with the entries skipped by the final flush, never freed, the late entries
+  // of the chunks are looked up by the chunk begin pointer
+  struct pending_chunk_t {
+    pointer_t begin;
+    Entry* chunk;
+  };
+  std::list<pending_chunk_t> pending_list_;
 
   flush_prm_t* flush_prm_arr_;
   uint32_t flush_prm_count_;
+  std::vector<callback_t> dispatch_table_;
   volatile std::atomic<bool> is_flushed_;
 
-  pthread_t work_thread_;
+  // Streaming flush state, the entries before the flush pointer are consumed,
+  // the begin pointer is the first entry of the buf_list_ front chunk
+  pointer_t begin_pointer_;
+  pointer_t flush_pointer_;
+  mutex_t flush_mutex_;
+  bool flush_stop_;
+  pthread_t flush_thread_;
+  pthread_cond_t flush_cond_;
+
   pthread_mutex_t work_mutex_;
-  pthread_cond_t work_cond_;
 
   mutex_t mutex_;
 };
@@ -0,0 +1,81 @@
+/******************************************************************************
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef SRC_PROXY_AGENT_TABLE_H_
+#define SRC_PROXY_AGENT_TABLE_H_
+
+#include <hsa.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+namespace proxy {
+// Per-agent objects, created on the first lookup, the agents are looked up lock-free
+template <class T>
+class AgentTable {
+  public:
+  static const uint32_t AGENTS_MAX = 64;
+
+  AgentTable() : count_(0) {}
+
+  ~AgentTable() {
+    const uint32_t count = count_.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i) delete obj_arr_[i];
+  }
+
+  // Returns NULL if the agents number is exceeded
+  T* Get(const hsa_agent_t& agent) {
+    uint32_t count = count_.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i) {
+      if (agent_arr_[i] == agent.handle) return obj_arr_[i];
+    }
+
+    std::lock_guard<std::mutex> lck(mutex_);
+    count = count_.load(std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+      if (agent_arr_[i] == agent.handle) return obj_arr_[i];
+    }
+    if (count == AGENTS_MAX) return NULL;
+    agent_arr_[count] = agent.handle;
+    obj_arr_[count] = new T;
+    count_.store(count + 1, std::memory_order_release);
+    return obj_arr_[count];
+  }
+
+  template <class F>
+  void ForEach(F f) const {
+    const uint32_t count = count_.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i) f(obj_arr_[i]);
+  }
+
+  private:
+  uint64_t agent_arr_[AGENTS_MAX];
+  T* obj_arr_[AGENTS_MAX];
+  std::atomic<uint32_t> count_;
+  std::mutex mutex_;
+};
+
+} // namespace proxy
+
+#endif // SRC_PROXY_AGENT_TABLE_H_
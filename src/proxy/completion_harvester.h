@@ -0,0 +1,201 @@
+/******************************************************************************
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef SRC_PROXY_COMPLETION_HARVESTER_H_
+#define SRC_PROXY_COMPLETION_HARVESTER_H_
+
+#include <errno.h>
+#include <hsa.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <vector>
+
+#include "proxy/signal_pool.h"
+
+#define PTHREAD_CALL(call)                                                                         \
+  do {                                                                                             \
+    int err = call;                                                                                \
+    if (err != 0) {                                                                                \
+      errno = err;                                                                                 \
+      perror(#call);                                                                               \
+      abort();                                                                                     \
+    }                                                                                              \
+  } while (0)
+
+namespace proxy {
+// Completion harvester of the tracked entries of an agent.
+// The submitting threads add the entries to a bounded lock-free ring, one harvester thread
+// moves them to its pending list and polls their signals in batches. The thread waits for
+// the oldest pending signal, the later completions are collected on its completion or on
+// the wait timeout, and sleeps while nothing is pending. The completed entries are passed
+// to 'Completer::Harvest(signal_value, entry)'. The entries not completed by the stop and
+// the entries added after it are passed to 'Completer::Detach(entry)', the completer tracks
+// them asynchronously, so neither the stop nor the adding thread waits for the device.
+template <class Entry, class Completer, class SignalApi = HsaSignalApi>
+class CompletionHarvester {
+  public:
+  static const uint32_t RING_SIZE = 4096;
+  // Out of order completions latency bound
+  static const uint64_t WAIT_TIMEOUT_NS = 100000;
+
+  CompletionHarvester() : enqueue_pos_(0), dequeue_pos_(0), idle_(false), stop_(false), adding_(0) {
+    for (uint32_t i = 0; i < RING_SIZE; ++i) ring_[i].seq.store(i, std::memory_order_relaxed);
+    wait_timeout_ = SignalApi::WaitTimeout(WAIT_TIMEOUT_NS);
+    PTHREAD_CALL(pthread_mutex_init(&mutex_, NULL));
+    PTHREAD_CALL(pthread_cond_init(&cond_, NULL));
+    PTHREAD_CALL(pthread_create(&thread_, NULL, harvest_worker, this));
+  }
+
+  ~CompletionHarvester() {
+    Stop();
+    PTHREAD_CALL(pthread_cond_destroy(&cond_));
+    PTHREAD_CALL(pthread_mutex_destroy(&mutex_));
+  }
+
+  // Adding a submitted entry, waits if the ring is full
+  void Add(Entry* entry) {
+    // Sequentially consistent with the stop flag store and the harvester adding count check,
+    // the harvester drains the ring until the started adds are done
+    adding_.fetch_add(1, std::memory_order_seq_cst);
+    if (stop_.load(std::memory_order_seq_cst)) {
+      adding_.fetch_sub(1, std::memory_order_release);
+      Completer::Detach(entry);
+      return;
+    }
+
+    uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    cell_t* cell = NULL;
+    while (1) {
+      cell = &ring_[pos % RING_SIZE];
+      const int64_t diff = (int64_t)cell->seq.load(std::memory_order_acquire) - (int64_t)pos;
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else {
+        if (diff < 0) sched_yield();
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->entry = entry;
+    // Sequentially consistent with the harvester idle flag and ring check, not to lose the wakeup
+    cell->seq.store(pos + 1, std::memory_order_seq_cst);
+    if (idle_.load(std::memory_order_seq_cst)) {
+      PTHREAD_CALL(pthread_mutex_lock(&mutex_));
+      PTHREAD_CALL(pthread_cond_signal(&cond_));
+      PTHREAD_CALL(pthread_mutex_unlock(&mutex_));
+    }
+    adding_.fetch_sub(1, std::memory_order_release);
+  }
+
+  // Stopping the harvester, the completed pending entries are harvested and the rest is detached
+  void Stop() {
+    PTHREAD_CALL(pthread_mutex_lock(&mutex_));
+    const bool is_stopped = stop_.exchange(true);
+    PTHREAD_CALL(pthread_cond_signal(&cond_));
+    PTHREAD_CALL(pthread_mutex_unlock(&mutex_));
+    if (is_stopped == false) PTHREAD_CALL(pthread_join(thread_, NULL));
+  }
+
+  private:
+  struct cell_t {
+    std::atomic<uint64_t> seq;
+    Entry* entry;
+  };
+
+  static void* harvest_worker(void* arg) {
+    CompletionHarvester* obj = reinterpret_cast<CompletionHarvester*>(arg);
+    std::vector<Entry*> pending;
+    pending.reserve(RING_SIZE);
+    while (1) {
+      obj->drain(&pending);
+      if (obj->stop_.load(std::memory_order_seq_cst)) {
+        // Waiting for the adds started before the stop, the later ones are detached by the adding thread
+        while (obj->adding_.load(std::memory_order_seq_cst) != 0) {
+          sched_yield();
+          obj->drain(&pending);
+        }
+        obj->drain(&pending);
+        obj->collect(&pending);
+        for (Entry* entry : pending) Completer::Detach(entry);
+        break;
+      }
+      if (pending.empty()) {
+        obj->wait_added();
+        continue;
+      }
+      SignalApi::Wait(pending.front()->signal, obj->wait_timeout_);
+      obj->collect(&pending);
+    }
+    return NULL;
+  }
+
+  // Moving the added entries to the pending list
+  void drain(std::vector<Entry*>* pending) {
+    while (1) {
+      cell_t* cell = &ring_[dequeue_pos_ % RING_SIZE];
+      if (cell->seq.load(std::memory_order_acquire) != dequeue_pos_ + 1) break;
+      pending->push_back(cell->entry);
+      cell->seq.store(dequeue_pos_ + RING_SIZE, std::memory_order_release);
+      ++dequeue_pos_;
+    }
+  }
+
+  // Harvesting the completed entries, the pending list order is kept
+  void collect(std::vector<Entry*>* pending) {
+    typename std::vector<Entry*>::iterator out = pending->begin();
+    for (typename std::vector<Entry*>::iterator it = pending->begin(); it != pending->end(); ++it) {
+      const hsa_signal_value_t value = SignalApi::Load((*it)->signal);
+      if (value < 1) Completer::Harvest(value, *it);
+      else *out++ = *it;
+    }
+    pending->erase(out, pending->end());
+  }
+
+  // Sleeping until an entry is added or the harvester is stopped
+  void wait_added() {
+    PTHREAD_CALL(pthread_mutex_lock(&mutex_));
+    idle_.store(true, std::memory_order_seq_cst);
+    const bool empty = (ring_[dequeue_pos_ % RING_SIZE].seq.load(std::memory_order_seq_cst) != dequeue_pos_ + 1);
+    if (empty && !stop_.load(std::memory_order_relaxed)) PTHREAD_CALL(pthread_cond_wait(&cond_, &mutex_));
+    idle_.store(false, std::memory_order_relaxed);
+    PTHREAD_CALL(pthread_mutex_unlock(&mutex_));
+  }
+
+  cell_t ring_[RING_SIZE];
+  std::atomic<uint64_t> enqueue_pos_;
+  uint64_t dequeue_pos_;
+  std::atomic<bool> idle_;
+  std::atomic<bool> stop_;
+  std::atomic<uint32_t> adding_;
+  uint64_t wait_timeout_;
+  pthread_t thread_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cond_;
+};
+
+} // namespace proxy
+
+#endif // SRC_PROXY_COMPLETION_HARVESTER_H_
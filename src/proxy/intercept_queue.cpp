@@ -26,6 +26,7 @@ namespace rocprofiler {
 void InterceptQueue::HsaIntercept(HsaApiTable* table) {
   table->core_->hsa_queue_create_fn = rocprofiler::InterceptQueue::QueueCreate;
   table->core_->hsa_queue_destroy_fn = rocprofiler::InterceptQueue::QueueDestroy;
+  table->core_->hsa_executable_destroy_fn = rocprofiler::InterceptQueue::ExecutableDestroy;
 }
 
 InterceptQueue::mutex_t InterceptQueue::mutex_;
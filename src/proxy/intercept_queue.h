@@ -24,7 +24,6 @@ THE SOFTWARE.
 #define _SRC_CORE_INTERCEPT_QUEUE_H
 
 #include <amd_hsa_kernel_code.h>
-#include <cxxabi.h>
 #include <dlfcn.h>
 #include <sys/syscall.h>
 
@@ -34,16 +33,20 @@ THE SOFTWARE.
 #include <mutex>
 
 #include "core/trace_buffer.h"
+#include "proxy/kernel_cache.h"
 #include "proxy/tracker.h"
 #include "proxy/proxy_queue.h"
 #include "util/hsa_rsrc_factory.h"
 #include "util/exception.h"
+#include "util/name_table.h"
+#include "util/thread_ids.h"
 
 namespace roctracer { extern TraceBuffer<trace_entry_t> trace_buffer; }
 
 namespace rocprofiler {
 extern decltype(hsa_queue_create)* hsa_queue_create_fn;
 extern decltype(hsa_queue_destroy)* hsa_queue_destroy_fn;
+extern decltype(hsa_executable_destroy)* hsa_executable_destroy_fn;
 
 class InterceptQueue {
  public:
@@ -138,43 +141,60 @@ class InterceptQueue {
     }
   }
 
+  // The packets are processed by batches, the dispatch packets of a batch are classified first,
+  // their trace entries are reserved at once and the trackers are enabled in bulk.
+  // The batch is submitted before its entries are tracked, the tracking waits for the packet completion.
   static void OnSubmitCB(const void* in_packets, uint64_t count, uint64_t user_que_idx, void* data,
                          hsa_amd_queue_intercept_packet_writer writer) {
     const packet_t* packets_arr = reinterpret_cast<const packet_t*>(in_packets);
     InterceptQueue* obj = reinterpret_cast<InterceptQueue*>(data);
     Queue* proxy = obj->proxy_;
+    const uint32_t tid = roctracer::util::ThreadIds::Tid();
 
-    // Travers input packets
-    for (uint64_t j = 0; j < count; ++j) {
-      const packet_t* packet = &packets_arr[j];
+    hsa_kernel_dispatch_packet_t* dispatch_arr[SUBMIT_BATCH_SIZE];
+    hsa_signal_t signal_arr[SUBMIT_BATCH_SIZE];
+    ::proxy::Tracker::entry_t* entry_arr[SUBMIT_BATCH_SIZE];
+    for (uint64_t begin = 0; begin < count; begin += SUBMIT_BATCH_SIZE) {
+      const uint64_t end = (begin + SUBMIT_BATCH_SIZE < count) ? begin + SUBMIT_BATCH_SIZE : count;
 
       // Checking for dispatch packet type
-      if (GetHeaderType(packet) == HSA_PACKET_TYPE_KERNEL_DISPATCH) {
-        const hsa_kernel_dispatch_packet_t* dispatch_packet =
-            reinterpret_cast<const hsa_kernel_dispatch_packet_t*>(packet);
-
-        // Prepareing dispatch callback data
-        const hsa_signal_t completion_signal = dispatch_packet->completion_signal;
-        const amd_kernel_code_t* kernel_code = GetKernelCode(dispatch_packet);
-        const uint64_t kernel_symbol = kernel_code->runtime_loader_kernel_symbol;
-        const char* kernel_name = GetKernelName(kernel_symbol);
-
-        // Adding kernel timing tracker
-        ::proxy::Tracker::entry_t* entry = roctracer::trace_buffer.GetEntry();
-        entry->kernel.tid = syscall(__NR_gettid);
-        entry->kernel.name = kernel_name;
-        ::proxy::Tracker::Enable(roctracer::KERNEL_ENTRY_TYPE, obj->agent_info_->dev_id, completion_signal, entry);
-        const_cast<hsa_kernel_dispatch_packet_t*>(dispatch_packet)->completion_signal = entry->signal;
+      uint32_t dispatch_count = 0;
+      for (uint64_t j = begin; j < end; ++j) {
+        const packet_t* packet = &packets_arr[j];
+        if (GetHeaderType(packet) == HSA_PACKET_TYPE_KERNEL_DISPATCH) {
+          dispatch_arr[dispatch_count++] =
+            const_cast<hsa_kernel_dispatch_packet_t*>(reinterpret_cast<const hsa_kernel_dispatch_packet_t*>(packet));
+        }
+      }
+      if (dispatch_count == 0) {
+        submit(proxy, writer, &packets_arr[begin], end - begin);
+        continue;
       }
-    }
 
-    // Submitting the original packets if profiling was not enabled
-    if (writer != NULL) {
-      writer(packets_arr, count);
-    } else {
-      proxy->Submit(packets_arr, count);
+      // Prepareing dispatch callback data
+      roctracer::trace_buffer.GetEntries(entry_arr, dispatch_count);
+      for (uint32_t i = 0; i < dispatch_count; ++i) {
+        entry_arr[i]->kernel.name_id = ::proxy::KernelCache::Lookup(dispatch_arr[i]->kernel_object, GetKernelNameId);
+        entry_arr[i]->kernel.tid = tid;
+        signal_arr[i] = dispatch_arr[i]->completion_signal;
+      }
+
+      // Adding kernel timing trackers
+      ::proxy::Tracker::Enable(roctracer::KERNEL_ENTRY_TYPE, obj->agent_info_->dev_id, signal_arr, entry_arr, dispatch_count,
+                               util::HsaRsrcFactory::Instance().TimestampNs());
+      for (uint32_t i = 0; i < dispatch_count; ++i) dispatch_arr[i]->completion_signal = entry_arr[i]->signal;
+      submit(proxy, writer, &packets_arr[begin], end - begin);
+      ::proxy::Tracker::Track(entry_arr, dispatch_count);
     }
   }
+
+  // Invalidating the kernel descriptors cache on the executable destruction
+  static hsa_status_t ExecutableDestroy(hsa_executable_t executable) {
+    const hsa_status_t status = hsa_executable_destroy_fn(executable);
+    ::proxy::KernelCache::Invalidate();
+    return status;
+  }
+
 #if 0
   static void SetCallbacks(rocprofiler_callback_t dispatch_callback,
                            queue_callback_t create_callback,
@@ -192,6 +212,15 @@ class InterceptQueue {
   static void Enable(bool val) { is_enabled = val; }
 
  private:
+  // Submitting the packets by the interceptor writer or to the proxy queue
+  static void submit(Queue* proxy, hsa_amd_queue_intercept_packet_writer writer, const packet_t* packets, uint64_t count) {
+    if (writer != NULL) {
+      writer(packets, count);
+    } else {
+      proxy->Submit(packets, count);
+    }
+  }
+
   static void queue_event_callback(hsa_status_t status, hsa_queue_t *queue, void *arg) {
     if (status != HSA_STATUS_SUCCESS) EXC_ABORT(status, "queue error handling is not supported");
     InterceptQueue* obj = GetObj(queue);
@@ -203,37 +232,24 @@ class InterceptQueue {
     return static_cast<hsa_packet_type_t>((*header >> HSA_PACKET_HEADER_TYPE) & header_type_mask);
   }
 
-  static const amd_kernel_code_t* GetKernelCode(const hsa_kernel_dispatch_packet_t* dispatch_packet) {
+  static const amd_kernel_code_t* GetKernelCode(const uint64_t kernel_object) {
     const amd_kernel_code_t* kernel_code = NULL;
     hsa_status_t status =
         util::HsaRsrcFactory::Instance().LoaderApi()->hsa_ven_amd_loader_query_host_address(
-            reinterpret_cast<const void*>(dispatch_packet->kernel_object),
+            reinterpret_cast<const void*>(kernel_object),
             reinterpret_cast<const void**>(&kernel_code));
     if (HSA_STATUS_SUCCESS != status) {
-      kernel_code = reinterpret_cast<amd_kernel_code_t*>(dispatch_packet->kernel_object);
+      kernel_code = reinterpret_cast<amd_kernel_code_t*>(kernel_object);
     }
     return kernel_code;
   }
 
-  static const char* GetKernelName(const uint64_t kernel_symbol) {
+  // Kernel name id, the name is interned once per distinct kernel and demangled on the output
+  static uint64_t GetKernelNameId(const uint64_t kernel_object) {
     amd_runtime_loader_debug_info_t* dbg_info =
-        reinterpret_cast<amd_runtime_loader_debug_info_t*>(kernel_symbol);
+        reinterpret_cast<amd_runtime_loader_debug_info_t*>(GetKernelCode(kernel_object)->runtime_loader_kernel_symbol);
     const char* kernel_name = (dbg_info != NULL) ? dbg_info->kernel_name : NULL;
-    return (kernel_name != NULL) ? strdup(kernel_name) : strdup(kernel_none_);
-#if 0
-    // Kernel name is mangled name
-    // apply __cxa_demangle() to demangle it
-    const char* funcname = NULL;
-    if (kernel_name != NULL) {
-      size_t funcnamesize = 0;
-      int status;
-      const char* ret = abi::__cxa_demangle(kernel_name, NULL, &funcnamesize, &status);
-      funcname = (ret != 0) ? ret : strdup(kernel_name);
-    }
-    if (funcname == NULL) funcname = strdup(kernel_none_);
-
-    return funcname;
-#endif
+    return roctracer::util::NameTable::Instance()->Intern((kernel_name != NULL) ? kernel_name : kernel_none_);
   }
 
   // method to get an intercept queue object
@@ -275,6 +291,8 @@ class InterceptQueue {
     ProxyQueue::Destroy(proxy_);
   }
 
+  static const uint32_t SUBMIT_BATCH_SIZE = 64;
+
   static bool is_enabled;
 
   static mutex_t mutex_;
@@ -0,0 +1,77 @@
+/******************************************************************************
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef SRC_PROXY_KERNEL_CACHE_H_
+#define SRC_PROXY_KERNEL_CACHE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace proxy {
+// Per-thread direct mapped cache of the kernel descriptor lookups, the kernel object
+// is mapped to the resolved value, the interned kernel name id. The cache is invalidated
+// by bumping the generation on an executable destruction.
+class KernelCache {
+  public:
+  static const uint32_t SIZE = 256;
+  // Kernel descriptors are 64 bytes aligned
+  static const uint64_t KERNEL_OBJECT_ALIGN = 64;
+
+  // Returns the cached value or the one resolved by 'resolve(kernel_object)'
+  template <class F>
+  static uint64_t Lookup(const uint64_t& kernel_object, F resolve) {
+    const uint64_t generation = Generation()->load(std::memory_order_acquire);
+    entry_t* entry = &(Cache()[(kernel_object / KERNEL_OBJECT_ALIGN) % SIZE]);
+    if ((entry->kernel_object != kernel_object) || (entry->generation != generation)) {
+      entry->value = resolve(kernel_object);
+      entry->kernel_object = kernel_object;
+      entry->generation = generation;
+    }
+    return entry->value;
+  }
+
+  static void Invalidate() { Generation()->fetch_add(1, std::memory_order_release); }
+
+  private:
+  struct entry_t {
+    uint64_t kernel_object;
+    uint64_t value;
+    uint64_t generation;
+  };
+
+  static entry_t* Cache() {
+    static thread_local entry_t cache[SIZE];
+    return cache;
+  }
+
+  // The zero generation is never current, the cache is zero initialized
+  static std::atomic<uint64_t>* Generation() {
+    static std::atomic<uint64_t> generation(1);
+    return &generation;
+  }
+};
+
+} // namespace proxy
+
+#endif // SRC_PROXY_KERNEL_CACHE_H_
@@ -0,0 +1,181 @@
+/******************************************************************************
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*******************************************************************************/
+
+
+#ifndef SRC_PROXY_SIGNAL_POOL_H_
+#define SRC_PROXY_SIGNAL_POOL_H_
+
+#include <hsa.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "proxy/agent_table.h"
+
+namespace proxy {
+// HSA signal API used by the signal pool and the completion harvester,
+// a CPU stand-in can be used by the tests
+struct HsaSignalApi {
+  static hsa_status_t Create(hsa_signal_t* signal) { return hsa_signal_create(1, 0, NULL, signal); }
+  static void Reset(const hsa_signal_t& signal) { hsa_signal_store_relaxed(signal, 1); }
+  static void Destroy(const hsa_signal_t& signal) { hsa_signal_destroy(signal); }
+  static hsa_signal_value_t Load(const hsa_signal_t& signal) { return hsa_signal_load_scacquire(signal); }
+
+  // Waiting for the signal completion, the timeout is in the system timestamp ticks
+  static void Wait(const hsa_signal_t& signal, const uint64_t& timeout) {
+    hsa_signal_wait_scacquire(signal, HSA_SIGNAL_CONDITION_LT, 1, timeout, HSA_WAIT_STATE_BLOCKED);
+  }
+  static uint64_t WaitTimeout(const uint64_t& timeout_ns) {
+    uint64_t freq = 0;
+    hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &freq);
+    return timeout_ns * freq / 1000000000;
+  }
+};
+
+// Pool of the recycled completion signals.
+// The free signals are kept in a lock-free stack of the pool nodes, the node index and
+// the ABA tag are packed in the stack head. The nodes are allocated by slabs on demand
+// and are not freed before the pool destruction, a released signal is reset to 1.
+template <class SignalApi = HsaSignalApi>
+class SignalPool {
+  public:
+  typedef uint32_t index_t;
+
+  static const index_t INDEX_NIL = UINT32_MAX;
+  static const uint32_t SLAB_SIZE = 256;
+  static const uint32_t SLABS_MAX = 4096;
+
+  struct stats_t {
+    uint64_t hits;                                     // acquired from the pool
+    uint64_t misses;                                   // newly created
+  };
+
+  SignalPool() : head_(pack(INDEX_NIL, 0)), node_count_(0), hits_(0), misses_(0) {
+    for (uint32_t i = 0; i < SLABS_MAX; ++i) slab_arr_[i].store(NULL, std::memory_order_relaxed);
+  }
+
+  ~SignalPool() {
+    const index_t count = node_count_.load(std::memory_order_acquire);
+    for (index_t index = 0; index < count; ++index) SignalApi::Destroy(get_node(index)->signal);
+    for (uint32_t i = 0; i < SLABS_MAX; ++i) delete[] slab_arr_[i].load(std::memory_order_relaxed);
+  }
+
+  // Returns the signal node index or INDEX_NIL if a new signal can't be created
+  index_t Acquire(hsa_signal_t* signal) {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (unpack_index(head) != INDEX_NIL) {
+      node_t* node = get_node(unpack_index(head));
+      const uint64_t next = pack(node->next.load(std::memory_order_relaxed), unpack_tag(head) + 1);
+      if (head_.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        SignalApi::Reset(node->signal);
+        *signal = node->signal;
+        return unpack_index(head);
+      }
+    }
+
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    hsa_signal_t new_signal{};
+    if (SignalApi::Create(&new_signal) != HSA_STATUS_SUCCESS) return INDEX_NIL;
+    const index_t index = new_node(new_signal);
+    if (index == INDEX_NIL) {
+      SignalApi::Destroy(new_signal);
+      return INDEX_NIL;
+    }
+    *signal = new_signal;
+    return index;
+  }
+
+  // Returning the signal to the pool
+  void Release(const index_t& index) {
+    node_t* node = get_node(index);
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    do {
+      node->next.store(unpack_index(head), std::memory_order_relaxed);
+    } while (!head_.compare_exchange_weak(head, pack(index, unpack_tag(head) + 1),
+                                          std::memory_order_release, std::memory_order_relaxed));
+  }
+
+  hsa_signal_t Signal(const index_t& index) const { return get_node(index)->signal; }
+
+  void GetStats(stats_t* stats) const {
+    stats->hits = hits_.load(std::memory_order_relaxed);
+    stats->misses = misses_.load(std::memory_order_relaxed);
+  }
+
+  private:
+  struct node_t {
+    hsa_signal_t signal;
+    std::atomic<index_t> next;
+  };
+
+  static uint64_t pack(const index_t& index, const uint32_t& tag) { return ((uint64_t)tag << 32) | index; }
+  static index_t unpack_index(const uint64_t& head) { return (index_t)head; }
+  static uint32_t unpack_tag(const uint64_t& head) { return (uint32_t)(head >> 32); }
+
+  node_t* get_node(const index_t& index) const {
+    return slab_arr_[index / SLAB_SIZE].load(std::memory_order_acquire) + (index % SLAB_SIZE);
+  }
+
+  // Growing the pool, a new slab is allocated by the thread taking its first node
+  index_t new_node(const hsa_signal_t& signal) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    const index_t index = node_count_.load(std::memory_order_relaxed);
+    if (index == SLAB_SIZE * SLABS_MAX) return INDEX_NIL;
+    if ((index % SLAB_SIZE) == 0) slab_arr_[index / SLAB_SIZE].store(new node_t[SLAB_SIZE], std::memory_order_release);
+    node_t* node = get_node(index);
+    node->signal = signal;
+    node->next.store(INDEX_NIL, std::memory_order_relaxed);
+    node_count_.store(index + 1, std::memory_order_release);
+    return index;
+  }
+
+  std::atomic<uint64_t> head_;
+  std::atomic<node_t*> slab_arr_[SLABS_MAX];
+  std::atomic<index_t> node_count_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::mutex mutex_;
+};
+
+// Signal pools of the agents
+template <class SignalApi = HsaSignalApi>
+class AgentSignalPools : public AgentTable<SignalPool<SignalApi> > {
+  public:
+  typedef SignalPool<SignalApi> pool_t;
+
+  void GetStats(typename pool_t::stats_t* stats) const {
+    stats->hits = 0;
+    stats->misses = 0;
+    this->ForEach([stats](const pool_t* pool) {
+      typename pool_t::stats_t pool_stats{};
+      pool->GetStats(&pool_stats);
+      stats->hits += pool_stats.hits;
+      stats->misses += pool_stats.misses;
+    });
+  }
+};
+
+} // namespace proxy
+
+#endif // SRC_PROXY_SIGNAL_POOL_H_
@@ -34,56 +34,130 @@ THE SOFTWARE.
 #include "util/exception.h"
 #include "util/logger.h"
 #include "core/trace_buffer.h"
+#include "proxy/agent_table.h"
+#include "proxy/completion_harvester.h"
+#include "proxy/signal_pool.h"
 
 namespace proxy {
 class Tracker {
   public:
   typedef util::HsaRsrcFactory::timestamp_t timestamp_t;
   typedef roctracer::trace_entry_t entry_t;
+  typedef AgentSignalPools<> signal_pools_t;
+  typedef signal_pools_t::pool_t signal_pool_t;
+  typedef signal_pool_t::stats_t signal_stats_t;
+  typedef CompletionHarvester<entry_t, Tracker> harvester_t;
+  typedef AgentTable<harvester_t> harvesters_t;
 
   // Add tracker entry
   inline static void Enable(uint32_t type, const hsa_agent_t& agent, const hsa_signal_t& signal, entry_t* entry) {
-    hsa_status_t status = HSA_STATUS_ERROR;
-    util::HsaRsrcFactory* hsa_rsrc = &(util::HsaRsrcFactory::Instance());
+    Enable(type, agent, &signal, &entry, 1, util::HsaRsrcFactory::Instance().TimestampNs());
+  }
 
-    // Creating a new tracker entry
-    entry->type = type;
-    entry->agent = agent;
-    entry->dev_index = 0; //hsa_rsrc->GetAgentInfo(agent)->dev_index;
-    entry->orig = signal;
-    entry->dispatch = hsa_rsrc->TimestampNs();
-    entry->valid.store(roctracer::TRACE_ENTRY_INIT, std::memory_order_release);
-
-    // Creating a proxy signal
-    status = hsa_signal_create(1, 0, NULL, &(entry->signal));
-    if (status != HSA_STATUS_SUCCESS) EXC_RAISING(status, "hsa_signal_create");
-    status = hsa_amd_signal_async_handler(entry->signal, HSA_SIGNAL_CONDITION_LT, 1, Handler, entry);
-    if (status != HSA_STATUS_SUCCESS) EXC_RAISING(status, "hsa_amd_signal_async_handler");
+  // Add tracker entries of the same type and agent submitted at once, 'signal_arr' are
+  // the original completion signals. The entry completion fields are left to the completion.
+  inline static void Enable(uint32_t type, const hsa_agent_t& agent, const hsa_signal_t* signal_arr,
+                            entry_t* const* entry_arr, uint32_t count, timestamp_t dispatch) {
+    signal_pool_t* signal_pool = signal_pools_->Get(agent);
+    if (signal_pool == NULL) EXC_RAISING(HSA_STATUS_ERROR, "Tracker: too many agents");
+
+    for (uint32_t i = 0; i < count; ++i) {
+      entry_t* entry = entry_arr[i];
+
+      // Creating a new tracker entry
+      entry->type = type;
+      entry->agent = agent;
+      entry->orig = signal_arr[i];
+      entry->dispatch = dispatch;
+      entry->valid.store(roctracer::TRACE_ENTRY_INIT, std::memory_order_release);
+
+      // Taking a proxy signal from the agent signal pool
+      entry->signal_index = signal_pool->Acquire(&(entry->signal));
+      if (entry->signal_index == signal_pool_t::INDEX_NIL) EXC_RAISING(HSA_STATUS_ERROR, "hsa_signal_create");
+    }
+  }
+
+  // Start tracking the submitted entry completion, by the agent completion harvester
+  // if enabled or by the signal async handler
+  inline static void Track(entry_t* entry) {
+    if (harvesters_ != NULL) {
+      harvester_t* harvester = harvesters_->Get(entry->agent);
+      if (harvester == NULL) EXC_RAISING(HSA_STATUS_ERROR, "Tracker: too many agents");
+      harvester->Add(entry);
+    } else {
+      Detach(entry);
+    }
   }
 
-  // Delete tracker entry
+  inline static void Track(entry_t* const* entry_arr, uint32_t count) {
+    if (harvesters_ != NULL) {
+      harvester_t* harvester = (count != 0) ? harvesters_->Get(entry_arr[0]->agent) : NULL;
+      if ((harvester == NULL) && (count != 0)) EXC_RAISING(HSA_STATUS_ERROR, "Tracker: too many agents");
+      for (uint32_t i = 0; i < count; ++i) harvester->Add(entry_arr[i]);
+    } else {
+      for (uint32_t i = 0; i < count; ++i) Track(entry_arr[i]);
+    }
+  }
+
+  // Delete not tracked entry
   inline static void Disable(entry_t* entry) {
-    hsa_signal_destroy(entry->signal);
+    signal_pools_->Get(entry->agent)->Release(entry->signal_index);
     entry->valid.store(roctracer::TRACE_ENTRY_INV, std::memory_order_release);
   }
 
+  // Stopping the completion harvesters, the already completed entries are harvested
+  // and the rest is passed to the signal async handlers
+  static void Stop() {
+    if (harvesters_ != NULL) harvesters_->ForEach([](harvester_t* harvester) { harvester->Stop(); });
+  }
+
+  // Signal pools hits/misses for all agents
+  static void GetSignalStats(signal_stats_t* stats) { signal_pools_->GetStats(stats); }
+
   private:
+  friend harvester_t;
+
+  // Proxy signal pools, not destroyed to not release the signals after the runtime unload
+  static signal_pools_t* signal_pools_;
+  // Completion harvesters, enabled by ROCTRACER_COMPLETION_HARVESTER
+  static harvesters_t* harvesters_;
+
+  struct pending_signal_t {
+    signal_pool_t* pool;
+    signal_pool_t::index_t index;
+  };
+
+  static harvesters_t* CreateHarvesters() {
+    const char* str = getenv("ROCTRACER_COMPLETION_HARVESTER");
+    return ((str != NULL) && (atoi(str) != 0)) ? new harvesters_t : NULL;
+  }
+
   // Entry completion
+  // The entry can be consumed by the trace buffer flush once it is marked completed,
+  // the fields used after are read before
   inline static void Complete(hsa_signal_value_t signal_value, entry_t* entry) {
+    const hsa_signal_t signal = entry->signal;
+    const hsa_signal_t orig = entry->orig;
+
     // Query begin/end and complete timestamps
     util::HsaRsrcFactory* hsa_rsrc = &(util::HsaRsrcFactory::Instance());
     if (entry->type == roctracer::COPY_ENTRY_TYPE) {
       hsa_amd_profiling_async_copy_time_t async_copy_time{};
-      hsa_status_t status = hsa_amd_profiling_get_async_copy_time(entry->signal, &async_copy_time);
+      hsa_status_t status = hsa_amd_profiling_get_async_copy_time(signal, &async_copy_time);
       if (status != HSA_STATUS_SUCCESS) EXC_RAISING(status, "hsa_amd_profiling_get_async_copy_time");
-      entry->begin = hsa_rsrc->SysclockToNs(async_copy_time.start);
-      entry->end = hsa_rsrc->SysclockToNs(async_copy_time.end);
+      timestamp_t time[2] = {async_copy_time.start, async_copy_time.end};
+      hsa_rsrc->SysclockToNs(time, time, 2);
+      entry->begin = time[0];
+      entry->end = time[1];
+      entry->dev_index = 0;
     } else {
       hsa_amd_profiling_dispatch_time_t dispatch_time{};
-      hsa_status_t status = hsa_amd_profiling_get_dispatch_time(entry->agent, entry->signal, &dispatch_time);
+      hsa_status_t status = hsa_amd_profiling_get_dispatch_time(entry->agent, signal, &dispatch_time);
       if (status != HSA_STATUS_SUCCESS) EXC_RAISING(status, "hsa_amd_profiling_get_dispatch_time");
-      entry->begin = hsa_rsrc->SysclockToNs(dispatch_time.start);
-      entry->end = hsa_rsrc->SysclockToNs(dispatch_time.end);
+      timestamp_t time[2] = {dispatch_time.start, dispatch_time.end};
+      hsa_rsrc->SysclockToNs(time, time, 2);
+      entry->begin = time[0];
+      entry->end = time[1];
       entry->dev_index = (hsa_rsrc->GetAgentInfo(entry->agent))->dev_index;
     }
 
@@ -91,10 +165,9 @@ class Tracker {
     entry->valid.store(roctracer::TRACE_ENTRY_COMPL, std::memory_order_release);
 
     // Original intercepted signal completion
-    hsa_signal_t orig = entry->orig;
     if (orig.handle) {
       amd_signal_t* orig_signal_ptr = reinterpret_cast<amd_signal_t*>(orig.handle);
-      amd_signal_t* prof_signal_ptr = reinterpret_cast<amd_signal_t*>(entry->signal.handle);
+      amd_signal_t* prof_signal_ptr = reinterpret_cast<amd_signal_t*>(signal.handle);
       orig_signal_ptr->start_ts = prof_signal_ptr->start_ts;
       orig_signal_ptr->end_ts = prof_signal_ptr->end_ts;
 
@@ -102,7 +175,6 @@ class Tracker {
       if (signal_value != new_value) EXC_ABORT(HSA_STATUS_ERROR, "Tracker::Complete bad signal value");
       hsa_signal_store_screlease(orig, signal_value);
     }
-    hsa_signal_destroy(entry->signal);
   }
 
   // Handler for packet completion
@@ -110,12 +182,36 @@ class Tracker {
     // Acquire entry
     entry_t* entry = reinterpret_cast<entry_t*>(arg);
     while (entry->valid.load(std::memory_order_acquire) != roctracer::TRACE_ENTRY_INIT) sched_yield();
+    signal_pool_t* signal_pool = signal_pools_->Get(entry->agent);
+    const signal_pool_t::index_t signal_index = entry->signal_index;
 
     // Complete entry
     Tracker::Complete(signal_value, entry);
 
+    // The entry handler is deregistered on return, so the proxy signal is recycled on the next
+    // completion on the handler thread, not to trigger the handler for the signal next user
+    static thread_local pending_signal_t pending{NULL, 0};
+    if (pending.pool != NULL) pending.pool->Release(pending.index);
+    pending.pool = signal_pool;
+    pending.index = signal_index;
+
     return false;
   }
+
+  // Tracking the entry by the signal async handler, the harvester passes the entries
+  // it cannot complete once stopped
+  static void Detach(entry_t* entry) {
+    const hsa_status_t status = hsa_amd_signal_async_handler(entry->signal, HSA_SIGNAL_CONDITION_LT, 1, Handler, entry);
+    if (status != HSA_STATUS_SUCCESS) EXC_RAISING(status, "hsa_amd_signal_async_handler");
+  }
+
+  // Harvested entry completion, the entry was added after its initialization
+  static void Harvest(hsa_signal_value_t signal_value, entry_t* entry) {
+    signal_pool_t* signal_pool = signal_pools_->Get(entry->agent);
+    const signal_pool_t::index_t signal_index = entry->signal_index;
+    Tracker::Complete(signal_value, entry);
+    signal_pool->Release(signal_index);
+  }
 };
 
 } // namespace rocprofiler
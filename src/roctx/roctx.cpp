@@ -121,12 +121,14 @@ PUBLIC_API const char* roctracer_error_string() {
 
 PUBLIC_API void roctxMarkA(const char* message) {
   API_METHOD_PREFIX
-  roctx_api_data_t api_data{};
-  api_data.args.roctxMarkA.message = strdup(message);
-  activity_rtapi_callback_t api_callback_fun = NULL;
-  void* api_callback_arg = NULL;
-  roctx::cb_table.get(ROCTX_API_ID_roctxMarkA, &api_callback_fun, &api_callback_arg);
-  if (api_callback_fun) api_callback_fun(ACTIVITY_DOMAIN_ROCTX, ROCTX_API_ID_roctxMarkA, &api_data, api_callback_arg);
+  if (roctx::cb_table.enabled(ROCTX_API_ID_roctxMarkA)) {
+    roctx_api_data_t api_data{};
+    api_data.args.roctxMarkA.message = strdup(message);
+    activity_rtapi_callback_t api_callback_fun = NULL;
+    void* api_callback_arg = NULL;
+    roctx::cb_table.get(ROCTX_API_ID_roctxMarkA, &api_callback_fun, &api_callback_arg);
+    if (api_callback_fun) api_callback_fun(ACTIVITY_DOMAIN_ROCTX, ROCTX_API_ID_roctxMarkA, &api_data, api_callback_arg);
+  }
   API_METHOD_SUFFIX_NRET
 }
 
@@ -134,12 +136,14 @@ PUBLIC_API int roctxRangePushA(const char* message) {
   API_METHOD_PREFIX
   if (roctx::message_stack == NULL) roctx::thread_data_init();
 
-  roctx_api_data_t api_data{};
-  api_data.args.roctxRangePushA.message = strdup(message);
-  activity_rtapi_callback_t api_callback_fun = NULL;
-  void* api_callback_arg = NULL;
-  roctx::cb_table.get(ROCTX_API_ID_roctxRangePushA, &api_callback_fun, &api_callback_arg);
-  if (api_callback_fun) api_callback_fun(ACTIVITY_DOMAIN_ROCTX, ROCTX_API_ID_roctxRangePushA, &api_data, api_callback_arg);
+  if (roctx::cb_table.enabled(ROCTX_API_ID_roctxRangePushA)) {
+    roctx_api_data_t api_data{};
+    api_data.args.roctxRangePushA.message = strdup(message);
+    activity_rtapi_callback_t api_callback_fun = NULL;
+    void* api_callback_arg = NULL;
+    roctx::cb_table.get(ROCTX_API_ID_roctxRangePushA, &api_callback_fun, &api_callback_arg);
+    if (api_callback_fun) api_callback_fun(ACTIVITY_DOMAIN_ROCTX, ROCTX_API_ID_roctxRangePushA, &api_data, api_callback_arg);
+  }
   roctx::message_stack->push(strdup(message));
 
   return roctx::message_stack->size() - 1;
@@ -49,4 +49,14 @@ PUBLIC_API bool RemoveApiCallback(uint32_t op) {
   return roctx::cb_table.set(op, NULL, NULL);
 }
 
+PUBLIC_API bool RegisterApiCallbackAll(void* callback, void* arg) {
+  roctx::cb_table.set_all(reinterpret_cast<activity_rtapi_callback_t>(callback), arg);
+  return true;
+}
+
+PUBLIC_API bool RemoveApiCallbackAll() {
+  roctx::cb_table.set_all(NULL, NULL);
+  return true;
+}
+
 }  // extern "C"
@@ -0,0 +1,223 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SRC_UTIL_DEMANGLER_H_
+#define SRC_UTIL_DEMANGLER_H_
+
+#include <cxxabi.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace roctracer {
+namespace util {
+
+// C++ names demangler shared by the output writers.
+// The demangled names are kept in a bounded LRU cache keyed by the mangled name hash, the
+// hit is verified by the mangled name compare. The names can be truncated to the base ones,
+// as by 'rpl_run.sh --basenames on' which sets ROCP_TRUNCATE_NAMES=1. A set of names can be
+// demangled in parallel before the output, the distinct not cached ones are split between
+// the worker threads.
+class Demangler {
+  public:
+  typedef std::mutex mutex_t;
+
+  static const uint32_t CAPACITY = 4096;
+  static const uint32_t NAMES_PER_THREAD_MIN = 64;
+
+  Demangler(uint32_t capacity, bool basenames) :
+    capacity_((capacity != 0) ? capacity : 1),
+    basenames_(basenames)
+  {}
+
+  // The instance is created on the first use and never destroyed
+  static Demangler* Instance() {
+    std::atomic<Demangler*>& instance = instance_ptr();
+    Demangler* obj = instance.load(std::memory_order_acquire);
+    if (obj == NULL) {
+      const char* str = getenv("ROCP_TRUNCATE_NAMES");
+      Demangler* created = new Demangler(CAPACITY, (str != NULL) && (atoi(str) != 0));
+      if (instance.compare_exchange_strong(obj, created, std::memory_order_acq_rel)) {
+        obj = created;
+      } else {
+        delete created;
+      }
+    }
+    return obj;
+  }
+
+  // Demangled name, the name itself if it is not a mangled one
+  std::string Demangle(const char* name) {
+    const uint64_t hash = Hash(name);
+    {
+      std::lock_guard<mutex_t> lck(mutex_);
+      map_t::iterator it = map_.find(hash);
+      if ((it != map_.end()) && (it->second->mangled == name)) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->demangled;
+      }
+    }
+    const std::string demangled = demangle(name);
+    insert(hash, name, demangled);
+    return demangled;
+  }
+
+  // Demangling the distinct not cached names of the set in parallel
+  void DemangleAll(const std::vector<const char*>& names) {
+    std::vector<std::pair<uint64_t, const char*>> todo;
+    {
+      std::lock_guard<mutex_t> lck(mutex_);
+      std::unordered_map<uint64_t, const char*> distinct;
+      for (const char* name : names) {
+        const uint64_t hash = Hash(name);
+        map_t::iterator it = map_.find(hash);
+        if ((it != map_.end()) && (it->second->mangled == name)) continue;
+        if (distinct.insert({hash, name}).second) todo.push_back({hash, name});
+      }
+    }
+    if (todo.size() > capacity_) todo.resize(capacity_);
+
+    const uint32_t count = todo.size();
+    uint32_t thread_count = std::thread::hardware_concurrency();
+    if (thread_count > count / NAMES_PER_THREAD_MIN) thread_count = count / NAMES_PER_THREAD_MIN;
+    if (thread_count == 0) thread_count = 1;
+
+    std::vector<std::string> demangled(count);
+    std::atomic<uint32_t> next(0);
+    auto worker = [&todo, &demangled, &next, count, this]() {
+      for (uint32_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) demangled[i] = demangle(todo[i].second);
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t t = 1; t < thread_count; ++t) threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads) thread.join();
+
+    for (uint32_t i = 0; i < count; ++i) insert(todo[i].first, todo[i].second, demangled[i]);
+  }
+
+  // The base name of a demangled function name, the trailing cv qualifiers, arguments,
+  // template arguments and clone suffix brackets are removed and then the scope and
+  // the return type
+  static std::string Basename(const std::string& full_name) {
+    static const char* qualifiers[] = {" const", " volatile"};
+    std::string name = full_name;
+    for (bool found = true; found;) {
+      found = false;
+      for (const char* qualifier : qualifiers) {
+        const size_t len = strlen(qualifier);
+        if ((name.size() > len) && (name.compare(name.size() - len, len, qualifier) == 0)) {
+          name.resize(name.size() - len);
+          found = true;
+        }
+      }
+    }
+
+    std::string::const_reverse_iterator rit = name.rbegin();
+    const std::string::const_reverse_iterator rend = name.rend();
+    uint32_t counter = 0;
+    char open_token = 0;
+    char close_token = 0;
+    while (rit != rend) {
+      if (counter == 0) {
+        switch (*rit) {
+          case ')': open_token = ')'; close_token = '('; break;
+          case '>': open_token = '>'; close_token = '<'; break;
+          case ']': open_token = ']'; close_token = '['; break;
+          case ' ': ++rit; continue;
+          default: open_token = 0;
+        }
+        if (open_token == 0) break;
+        counter = 1;
+      } else {
+        if (*rit == open_token) counter++;
+        if (*rit == close_token) counter--;
+      }
+      ++rit;
+    }
+    const std::string::const_reverse_iterator rbegin = rit;
+    while ((rit != rend) && (*rit != ' ') && (*rit != ':')) ++rit;
+    return name.substr(rend - rit, rit - rbegin);
+  }
+
+  // FNV-1a hash of the name
+  static uint64_t Hash(const char* name) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char* ptr = name; *ptr != 0; ++ptr) hash = (hash ^ (uint8_t)(*ptr)) * 1099511628211ULL;
+    return hash;
+  }
+
+  private:
+  struct node_t {
+    uint64_t hash;
+    std::string mangled;
+    std::string demangled;
+  };
+  typedef std::list<node_t> lru_t;
+  typedef std::unordered_map<uint64_t, lru_t::iterator> map_t;
+
+  std::string demangle(const char* name) const {
+    int status = 0;
+    char* ret = abi::__cxa_demangle(name, NULL, NULL, &status);
+    std::string demangled((ret != NULL) ? ret : name);
+    free(ret);
+    return (basenames_) ? Basename(demangled) : demangled;
+  }
+
+  // Inserting as the most recently used, the least recently used one is evicted
+  void insert(const uint64_t& hash, const char* name, const std::string& demangled) {
+    std::lock_guard<mutex_t> lck(mutex_);
+    map_t::iterator it = map_.find(hash);
+    if (it != map_.end()) {
+      lru_.erase(it->second);
+      map_.erase(it);
+    } else if (map_.size() >= capacity_) {
+      map_.erase(lru_.back().hash);
+      lru_.pop_back();
+    }
+    lru_.push_front({hash, name, demangled});
+    map_[hash] = lru_.begin();
+  }
+
+  static std::atomic<Demangler*>& instance_ptr() {
+    static std::atomic<Demangler*> instance(NULL);
+    return instance;
+  }
+
+  const uint32_t capacity_;
+  const bool basenames_;
+  lru_t lru_;
+  map_t map_;
+  mutex_t mutex_;
+};
+
+}  // namespace util
+}  // namespace roctracer
+
+#endif  // SRC_UTIL_DEMANGLER_H_
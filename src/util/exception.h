@@ -24,6 +24,7 @@ THE SOFTWARE.
 #define SRC_UTIL_EXCEPTION_H_
 
 #include <exception>
+#include <iostream>
 #include <sstream>
 #include <string>
 
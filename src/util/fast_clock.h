@@ -0,0 +1,254 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SRC_UTIL_FAST_CLOCK_H_
+#define SRC_UTIL_FAST_CLOCK_H_
+
+#include <hsa.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+#include <atomic>
+#include <mutex>
+
+#include "ext/hsa_rt_utils.hpp"
+
+namespace util {
+
+// Fast host clock calibrated against a reference clock in ns.
+// The source is the invariant TSC on x86-64 or CLOCK_MONOTONIC_RAW read through vDSO,
+// it can be selected by ROCTRACER_CLOCK=tsc|monotonic, ROCTRACER_CLOCK=hsa disables
+// the fast clock. The source ticks are converted with a fixed-point multiplier and
+// the conversion is periodically re-synchronized with the reference clock.
+// The process clock is calibrated once against the HSA system clock on the roctracer load.
+class FastClock {
+  public:
+  typedef uint64_t timestamp_t;
+  typedef timestamp_t (*ref_fun_t)(const void* arg);
+  typedef decltype(hsa_system_get_info)* hsa_system_get_info_fn_t;
+  typedef std::mutex mutex_t;
+
+  enum source_t {
+    SOURCE_NONE = 0,
+    SOURCE_TSC = 1,
+    SOURCE_MONOTONIC = 2
+  };
+
+  static const uint32_t SHIFT = 32;
+  static const timestamp_t CALIBRATION_NS = 1000000;
+  static const timestamp_t RESYNC_NS = 1000000000;
+  static const uint32_t SAMPLE_TRIES = 5;
+
+  // Creating and calibrating the process clock, the HSA system clock is the reference
+  static const FastClock* Create(hsa_system_get_info_fn_t get_info_fn) {
+    std::lock_guard<mutex_t> lck(mutex_);
+    FastClock* obj = instance_.load(std::memory_order_relaxed);
+    if (obj == NULL) {
+      sysclock_t* sysclock = new sysclock_t;
+      timestamp_t sysclock_hz = 0;
+      HSART_CALL(get_info_fn(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &sysclock_hz));
+      sysclock->get_info_fn = get_info_fn;
+      sysclock->converter.init(sysclock_hz);
+      obj = new FastClock;
+      obj->init(sysclock_ns, sysclock);
+      instance_.store(obj, std::memory_order_release);
+    }
+    return obj;
+  }
+
+  // Process clock if created and enabled, NULL otherwise
+  static const FastClock* Instance() {
+    const FastClock* obj = instance_.load(std::memory_order_acquire);
+    return ((obj != NULL) && obj->enabled()) ? obj : NULL;
+  }
+
+  FastClock() : source_(SOURCE_NONE), ref_fun_(NULL), ref_arg_(NULL), first_src_(0), first_ref_(0),
+    seq_(0), base_src_(0), base_ns_(0), mult_(0), resync_src_(0), resync_lock_(false) {}
+
+  // Source selection and initial calibration
+  void init(ref_fun_t ref_fun, const void* arg) {
+    source_ = select_source();
+    if (source_ == SOURCE_NONE) return;
+    ref_fun_ = ref_fun;
+    ref_arg_ = arg;
+
+    sample(&first_src_, &first_ref_);
+    timestamp_t src = 0;
+    timestamp_t ref = 0;
+    do sample(&src, &ref); while ((ref - first_ref_ < CALIBRATION_NS) || (src == first_src_));
+    const timestamp_t mult = rate(src, ref);
+    publish(src, ref, mult);
+  }
+
+  bool enabled() const { return source_ != SOURCE_NONE; }
+  source_t source() const { return source_; }
+
+  // Return timestamp in the reference clock 'ns'
+  timestamp_t timestamp_ns() const {
+    const timestamp_t src = read_source();
+    timestamp_t base_src, base_ns, mult, resync_src;
+    load(&base_src, &base_ns, &mult, &resync_src);
+    if ((src - base_src > resync_src) && (src > base_src)) {
+      if (resync_lock_.exchange(true, std::memory_order_acquire) == false) {
+        resync(base_src, base_ns, mult, resync_src);
+        resync_lock_.store(false, std::memory_order_release);
+      }
+    }
+    return convert(src, base_src, base_ns, mult);
+  }
+
+  private:
+  // HSA system clock reference of the process clock, not destroyed as the clock
+  struct sysclock_t {
+    hsa_system_get_info_fn_t get_info_fn;
+    hsa_rt_utils::TimestampConverter converter;
+  };
+
+  static timestamp_t sysclock_ns(const void* arg) {
+    const sysclock_t* sysclock = reinterpret_cast<const sysclock_t*>(arg);
+    timestamp_t timestamp;
+    HSART_CALL(sysclock->get_info_fn(HSA_SYSTEM_INFO_TIMESTAMP, &timestamp));
+    return sysclock->converter.to_ns(timestamp);
+  }
+
+  static source_t select_source() {
+    const char* str = getenv("ROCTRACER_CLOCK");
+    if (str != NULL) {
+      if (strcmp(str, "hsa") == 0) return SOURCE_NONE;
+      if (strcmp(str, "monotonic") == 0) return SOURCE_MONOTONIC;
+      if ((strcmp(str, "tsc") == 0) && !invariant_tsc()) return SOURCE_MONOTONIC;
+    }
+    return invariant_tsc() ? SOURCE_TSC : SOURCE_MONOTONIC;
+  }
+
+  static bool invariant_tsc() {
+#if defined(__x86_64__)
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) == 0) return false;
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+  }
+
+  timestamp_t read_source() const {
+#if defined(__x86_64__)
+    if (source_ == SOURCE_TSC) return __rdtsc();
+#endif
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (timestamp_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+  }
+
+  // Source and reference pair, the reference read is the midpoint of the tightest bracket
+  void sample(timestamp_t* src, timestamp_t* ref) const {
+    timestamp_t window = UINT64_MAX;
+    for (uint32_t i = 0; i < SAMPLE_TRIES; ++i) {
+      const timestamp_t ref1 = ref_fun_(ref_arg_);
+      const timestamp_t src1 = read_source();
+      const timestamp_t ref2 = ref_fun_(ref_arg_);
+      if (ref2 - ref1 < window) {
+        window = ref2 - ref1;
+        *src = src1;
+        *ref = ref1 + window / 2;
+      }
+    }
+  }
+
+  // Fixed-point ns per source tick over the whole calibration history
+  timestamp_t rate(const timestamp_t& src, const timestamp_t& ref) const {
+    return (timestamp_t)(((unsigned __int128)(ref - first_ref_) << SHIFT) / (src - first_src_));
+  }
+
+  static timestamp_t convert(const timestamp_t& src, const timestamp_t& base_src,
+                             const timestamp_t& base_ns, const timestamp_t& mult) {
+    const timestamp_t delta = (src > base_src) ? src - base_src : 0;
+    return base_ns + (timestamp_t)(((unsigned __int128)delta * mult) >> SHIFT);
+  }
+
+  // The conversion stays continuous at the new base, the drift against the reference
+  // is slewed out over the next re-synchronization interval
+  void resync(const timestamp_t& base_src, const timestamp_t& base_ns, const timestamp_t& mult,
+              const timestamp_t& resync_src) const {
+    timestamp_t src = 0;
+    timestamp_t ref = 0;
+    sample(&src, &ref);
+    const timestamp_t cur_ns = convert(src, base_src, base_ns, mult);
+    const timestamp_t new_rate = rate(src, ref);
+    const __int128 slew = ((__int128)((int64_t)(ref - cur_ns)) << SHIFT) / (__int128)resync_src;
+    __int128 new_mult = (__int128)new_rate + slew;
+    if (new_mult < (__int128)(new_rate / 2)) new_mult = new_rate / 2;
+    if (new_mult > (__int128)new_rate * 2) new_mult = (__int128)new_rate * 2;
+    publish(src, cur_ns, (timestamp_t)new_mult);
+  }
+
+  void publish(const timestamp_t& base_src, const timestamp_t& base_ns, const timestamp_t& mult) const {
+    seq_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    base_src_.store(base_src, std::memory_order_relaxed);
+    base_ns_.store(base_ns, std::memory_order_relaxed);
+    mult_.store(mult, std::memory_order_relaxed);
+    resync_src_.store((timestamp_t)(((unsigned __int128)RESYNC_NS << SHIFT) / mult), std::memory_order_relaxed);
+    seq_.fetch_add(1, std::memory_order_release);
+  }
+
+  void load(timestamp_t* base_src, timestamp_t* base_ns, timestamp_t* mult, timestamp_t* resync_src) const {
+    while (1) {
+      const uint32_t seq = seq_.load(std::memory_order_acquire);
+      *base_src = base_src_.load(std::memory_order_relaxed);
+      *base_ns = base_ns_.load(std::memory_order_relaxed);
+      *mult = mult_.load(std::memory_order_relaxed);
+      *resync_src = resync_src_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (((seq & 1) == 0) && (seq_.load(std::memory_order_relaxed) == seq)) break;
+    }
+  }
+
+  // Process clock, not destroyed to serve the late timestamps
+  static std::atomic<FastClock*> instance_;
+  static mutex_t mutex_;
+
+  source_t source_;
+  ref_fun_t ref_fun_;
+  const void* ref_arg_;
+  timestamp_t first_src_;
+  timestamp_t first_ref_;
+
+  // Conversion parameters and the re-synchronization interval in the source ticks
+  // published under the sequence counter
+  mutable std::atomic<uint32_t> seq_;
+  mutable std::atomic<timestamp_t> base_src_;
+  mutable std::atomic<timestamp_t> base_ns_;
+  mutable std::atomic<timestamp_t> mult_;
+  mutable std::atomic<timestamp_t> resync_src_;
+  mutable std::atomic<bool> resync_lock_;
+};
+
+}  // namespace util
+
+#endif  // SRC_UTIL_FAST_CLOCK_H_
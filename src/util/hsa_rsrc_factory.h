@@ -43,6 +43,9 @@ POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <vector>
 
+#include "ext/hsa_rt_utils.hpp"
+#include "util/fast_clock.h"
+
 #define HSA_ARGUMENT_ALIGN_BYTES 16
 #define HSA_QUEUE_ALIGN_BYTES 64
 #define HSA_PACKET_ALIGN_BYTES 64
@@ -174,11 +177,16 @@ class HsaTimer {
     hsa_status_t status = hsa_api_->hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &sysclock_hz);
     CHECK_STATUS("hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY)", status);
     sysclock_factor_ = (freq_t)1000000000 / (freq_t)sysclock_hz;
+    converter_.init(sysclock_hz);
+    clock_ = FastClock::Create(hsa_api_->hsa_system_get_info);
   }
 
   // Methods for system-clock/ns conversion
   timestamp_t sysclock_to_ns(const timestamp_t& sysclock) const {
-    return timestamp_t((freq_t)sysclock * sysclock_factor_);
+    return converter_.to_ns(sysclock);
+  }
+  void sysclock_to_ns(const timestamp_t* sysclock, timestamp_t* time, const size_t& count) const {
+    converter_.to_ns(sysclock, time, count);
   }
   timestamp_t ns_to_sysclock(const timestamp_t& time) const {
     return timestamp_t((freq_t)time / sysclock_factor_);
@@ -186,6 +194,7 @@ class HsaTimer {
 
   // Return timestamp in 'ns'
   timestamp_t timestamp_ns() const {
+    if (clock_->enabled()) return clock_->timestamp_ns();
     timestamp_t sysclock;
     hsa_status_t status = hsa_api_->hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP, &sysclock);
     CHECK_STATUS("hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP)", status);
@@ -195,8 +204,12 @@ class HsaTimer {
  private:
   // Timestamp frequency factor
   freq_t sysclock_factor_;
+  // System clock to ns converter
+  hsa_rt_utils::TimestampConverter converter_;
   // HSA API table
   const hsa_pfn_t* const hsa_api_;
+  // Process fast host clock
+  const FastClock* clock_;
 };
 
 class HsaRsrcFactory {
@@ -335,6 +348,7 @@ class HsaRsrcFactory {
 
   // Methods for system-clock/ns conversion and timestamp in 'ns'
   timestamp_t SysclockToNs(const timestamp_t& sysclock) const { return timer_->sysclock_to_ns(sysclock); }
+  void SysclockToNs(const timestamp_t* sysclock, timestamp_t* time, const size_t& count) const { timer_->sysclock_to_ns(sysclock, time, count); }
   timestamp_t NsToSysclock(const timestamp_t& time) const { return timer_->ns_to_sysclock(time); }
   timestamp_t TimestampNs() const { return timer_->timestamp_ns(); }
 
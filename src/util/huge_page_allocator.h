@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SRC_UTIL_HUGE_PAGE_ALLOCATOR_H_
+#define SRC_UTIL_HUGE_PAGE_ALLOCATOR_H_
+
+#include <linux/mempolicy.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace roctracer {
+namespace util {
+
+// Huge pages allocator for the trace buffers.
+// The memory is mapped with MAP_HUGETLB if huge pages are reserved, otherwise
+// transparent huge pages are requested. The memory is preferably placed on the NUMA node
+// of the allocating thread. The mapping size is kept in the header preceding the memory.
+class HugePageAllocator {
+ public:
+  static const size_t HUGE_PAGE_SIZE = 0x200000;
+  static const size_t HEADER_SIZE = 64;
+  static const unsigned NODES_MAX = 1024;
+
+  // Huge pages allocator is the default one if ROCTRACER_HUGE_PAGES is set
+  static bool Enabled() {
+    const char* str = getenv("ROCTRACER_HUGE_PAGES");
+    return (str != NULL) && (atoi(str) != 0);
+  }
+
+  static char* Allocate(size_t size) {
+    const size_t map_size = (size + HEADER_SIZE + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* base = mmap(NULL, map_size, prot, flags | MAP_HUGETLB, -1, 0);
+    if (base == MAP_FAILED) {
+      base = mmap(NULL, map_size, prot, flags, -1, 0);
+      if (base == MAP_FAILED) return NULL;
+      madvise(base, map_size, MADV_HUGEPAGE);
+    }
+    bind_local_node(base, map_size);
+
+    *reinterpret_cast<size_t*>(base) = map_size;
+    return reinterpret_cast<char*>(base) + HEADER_SIZE;
+  }
+
+  static void Free(char* ptr) {
+    char* base = ptr - HEADER_SIZE;
+    munmap(base, *reinterpret_cast<size_t*>(base));
+  }
+
+  static size_t Size(const char* ptr) {
+    return *reinterpret_cast<const size_t*>(ptr - HEADER_SIZE) - HEADER_SIZE;
+  }
+
+  // roctracer_allocator_t compatible allocator
+  static void allocator(char** ptr, size_t size, void* arg) {
+    (void)arg;
+    if (*ptr == NULL) {
+      *ptr = Allocate(size);
+    } else if (size != 0) {
+      char* new_ptr = Allocate(size);
+      if (new_ptr != NULL) {
+        const size_t old_size = Size(*ptr);
+        memcpy(new_ptr, *ptr, (old_size < size) ? old_size : size);
+      }
+      Free(*ptr);
+      *ptr = new_ptr;
+    } else {
+      Free(*ptr);
+      *ptr = NULL;
+    }
+  }
+
+ private:
+  // The memory is not touched yet, so the policy applies to all its pages
+  static void bind_local_node(void* base, size_t size) {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    if (syscall(__NR_getcpu, &cpu, &node, NULL) != 0) return;
+    const unsigned bits = 8 * sizeof(unsigned long);
+    unsigned long mask[NODES_MAX / bits];
+    if (node >= NODES_MAX) return;
+    memset(mask, 0, sizeof(mask));
+    mask[node / bits] = 1UL << (node % bits);
+    syscall(__NR_mbind, base, size, MPOL_PREFERRED, mask, 8 * sizeof(mask) + 1, 0);
+  }
+};
+
+}  // namespace util
+}  // namespace roctracer
+
+#endif  // SRC_UTIL_HUGE_PAGE_ALLOCATOR_H_
@@ -0,0 +1,177 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SRC_UTIL_NAME_TABLE_H_
+#define SRC_UTIL_NAME_TABLE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "util/demangler.h"
+
+namespace roctracer {
+namespace util {
+
+// Interned names table.
+// A name is copied once and mapped to a stable small id, the ids are dense and the names
+// are never freed, so the memory is O(distinct names). The interning is done under the lock
+// on a miss of the per-thread direct mapped cache keyed by the name pointer. The demangled
+// names are made lazily by the shared demangler, on the output, and kept per id.
+class NameTable {
+  public:
+  typedef uint32_t id_t;
+  typedef std::mutex mutex_t;
+  typedef std::unordered_map<std::string, id_t> map_t;
+
+  static const uint32_t CHUNK_SIZE = 1024;
+  static const uint32_t CHUNKS_MAX = 1024;
+  static const uint32_t CACHE_SIZE = 64;
+
+  // Constant initialized, the chunk table and the map are allocated on the first interning
+  constexpr NameTable() : chunk_table_(NULL), count_(0), map_(NULL) {}
+
+  // The table is never destroyed, the instance is constant initialized before any use
+  static NameTable* Instance() {
+    static NameTable instance;
+    return &instance;
+  }
+
+  // Returns the id of the not NULL name, the name is copied on the first interning
+  id_t Intern(const char* name) {
+    cache_entry_t* entry = &(Cache()[(reinterpret_cast<uintptr_t>(name) >> 4) % CACHE_SIZE]);
+    if ((entry->table == this) && (entry->name == name) && (strcmp(Name(entry->id), name) == 0)) return entry->id;
+    const id_t id = intern(name);
+    entry->table = this;
+    entry->name = name;
+    entry->id = id;
+    return id;
+  }
+
+  const char* Name(const id_t& id) const { return get_slot(id)->name; }
+
+  // Demangled name, the name itself if it is not a mangled one
+  const char* Demangled(const id_t& id) {
+    slot_t* slot = get_slot(id);
+    const char* demangled = slot->demangled.load(std::memory_order_acquire);
+    if (demangled == NULL) {
+      char* str = strdup(Demangler::Instance()->Demangle(slot->name).c_str());
+      const char* expected = NULL;
+      if (slot->demangled.compare_exchange_strong(expected, str, std::memory_order_acq_rel)) {
+        demangled = str;
+      } else {
+        free(str);
+        demangled = expected;
+      }
+    }
+    return demangled;
+  }
+
+  // Demangling all not yet demangled names in parallel, called before the final flush
+  void DemangleAll() {
+    const uint32_t count = Count();
+    std::vector<const char*> names;
+    std::vector<id_t> ids;
+    for (id_t id = 0; id < count; ++id) {
+      const slot_t* slot = get_slot(id);
+      if (slot->demangled.load(std::memory_order_relaxed) != NULL) continue;
+      names.push_back(slot->name);
+      ids.push_back(id);
+    }
+    if (names.empty()) return;
+    Demangler::Instance()->DemangleAll(names);
+    for (const id_t& id : ids) Demangled(id);
+  }
+
+  uint32_t Count() const { return count_.load(std::memory_order_acquire); }
+
+  private:
+  struct slot_t {
+    const char* name;
+    std::atomic<const char*> demangled;
+  };
+
+  struct cache_entry_t {
+    const NameTable* table;
+    const char* name;
+    id_t id;
+  };
+
+  static cache_entry_t* Cache() {
+    static thread_local cache_entry_t cache[CACHE_SIZE];
+    return cache;
+  }
+
+  id_t intern(const char* name) {
+    std::lock_guard<mutex_t> lck(mutex_);
+    if (map_ == NULL) {
+      map_ = new map_t;
+      chunk_table_.store(new std::atomic<slot_t*>[CHUNKS_MAX](), std::memory_order_release);
+    }
+    map_t::const_iterator it = map_->find(name);
+    if (it != map_->end()) return it->second;
+
+    const id_t id = count_.load(std::memory_order_relaxed);
+    const uint32_t chunk_index = id / CHUNK_SIZE;
+    if (chunk_index == CHUNKS_MAX) abort_run("NameTable::Intern: too many names");
+    std::atomic<slot_t*>* chunk_table = chunk_table_.load(std::memory_order_relaxed);
+    slot_t* chunk = chunk_table[chunk_index].load(std::memory_order_relaxed);
+    if (chunk == NULL) {
+      chunk = new slot_t[CHUNK_SIZE]();
+      chunk_table[chunk_index].store(chunk, std::memory_order_release);
+    }
+    slot_t* slot = &chunk[id % CHUNK_SIZE];
+    slot->name = strdup(name);
+    slot->demangled.store(NULL, std::memory_order_relaxed);
+    map_->insert({slot->name, id});
+    count_.store(id + 1, std::memory_order_release);
+    return id;
+  }
+
+  slot_t* get_slot(const id_t& id) const {
+    const std::atomic<slot_t*>* chunk_table = chunk_table_.load(std::memory_order_acquire);
+    return &(chunk_table[id / CHUNK_SIZE].load(std::memory_order_acquire)[id % CHUNK_SIZE]);
+  }
+
+  static void abort_run(const char* str) {
+    fprintf(stderr, "%s\n", str);
+    fflush(stderr);
+    abort();
+  }
+
+  std::atomic<std::atomic<slot_t*>*> chunk_table_;
+  std::atomic<id_t> count_;
+  map_t* map_;
+  mutex_t mutex_;
+};
+
+}  // namespace util
+}  // namespace roctracer
+
+#endif  // SRC_UTIL_NAME_TABLE_H_
@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SRC_UTIL_THREAD_IDS_H_
+#define SRC_UTIL_THREAD_IDS_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+
+namespace roctracer {
+namespace util {
+
+// Cached process and thread ids.
+// The ids are queried once per process/thread, the cache is reset in the fork child
+// by the handler registered with Init().
+class ThreadIds {
+  public:
+  static void Init() {
+    std::atomic<bool>& registered = atfork_registered();
+    if (registered.exchange(true) == false) pthread_atfork(NULL, NULL, fork_child);
+  }
+
+  static uint32_t Pid() {
+    std::atomic<uint32_t>& pid = pid_cache();
+    uint32_t value = pid.load(std::memory_order_relaxed);
+    if (value == 0) {
+      value = syscall(__NR_getpid);
+      pid.store(value, std::memory_order_relaxed);
+    }
+    return value;
+  }
+
+  static uint32_t Tid() {
+    uint32_t& tid = tid_cache();
+    if (tid == 0) tid = syscall(__NR_gettid);
+    return tid;
+  }
+
+  private:
+  static std::atomic<bool>& atfork_registered() {
+    static std::atomic<bool> registered(false);
+    return registered;
+  }
+
+  static std::atomic<uint32_t>& pid_cache() {
+    static std::atomic<uint32_t> pid(0);
+    return pid;
+  }
+
+  static uint32_t& tid_cache() {
+    static thread_local uint32_t tid = 0;
+    return tid;
+  }
+
+  // The child has only the forking thread
+  static void fork_child() {
+    pid_cache().store(0, std::memory_order_relaxed);
+    tid_cache() = 0;
+  }
+};
+
+}  // namespace util
+}  // namespace roctracer
+
+#endif  // SRC_UTIL_THREAD_IDS_H_
@@ -297,6 +297,7 @@ void init_tracing() {
   roctracer_properties_t properties{};
   properties.buffer_size = 0x1000;
   properties.buffer_callback_fun = activity_callback;
+  properties.drain_timeout = UINT32_MAX;
   ROCTRACER_CALL(roctracer_open_pool(&properties));
   // Enable HIP API callbacks
   ROCTRACER_CALL(roctracer_enable_domain_callback(ACTIVITY_DOMAIN_HIP_API, api_callback, NULL));
@@ -0,0 +1,154 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Callbacks table read path benchmark
+//
+// cb_table_bench <calls per thread> <max threads>
+// The interceptor of a hot HSA call, hsa_signal_load_relaxed, is modeled as generated
+// by hsaap.py. The previous mutex guarded table is compared with the atomic one with
+// no callback registered and with a callback registered, for 1..max threads.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cb_table.h"
+
+static const uint32_t API_ID_NUMBER = 256;
+static const uint32_t API_ID_hsa_signal_load_relaxed = 42;
+
+// Previous mutex guarded table
+class LockedCbTable {
+  public:
+  LockedCbTable() {
+    for (uint32_t i = 0; i < API_ID_NUMBER; i++) {
+      callback_[i] = NULL;
+      arg_[i] = NULL;
+    }
+  }
+
+  bool set(uint32_t id, activity_rtapi_callback_t callback, void* arg) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    callback_[id] = callback;
+    arg_[id] = arg;
+    return true;
+  }
+
+  bool get(uint32_t id, activity_rtapi_callback_t* callback, void** arg) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    *callback = callback_[id];
+    *arg = arg_[id];
+    return true;
+  }
+
+  private:
+  activity_rtapi_callback_t callback_[API_ID_NUMBER];
+  void* arg_[API_ID_NUMBER];
+  std::mutex mutex_;
+};
+
+struct signal_t { volatile int64_t value; };
+struct api_data_t {
+  uint32_t phase;
+  int64_t retval;
+  struct { signal_t* signal; } args;
+};
+
+std::atomic<uint64_t> callback_count{0};
+
+void api_callback(uint32_t domain, uint32_t cid, const void* data, void* arg) {
+  (void)domain;
+  (void)cid;
+  (void)data;
+  (void)arg;
+  callback_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+__attribute__((noinline)) int64_t hsa_signal_load_relaxed_fn(signal_t* signal) { return signal->value; }
+
+template <class Table>
+__attribute__((noinline)) int64_t hsa_signal_load_relaxed_callback(Table* cb_table, signal_t* signal) {
+  api_data_t api_data{};
+  api_data.args.signal = signal;
+  activity_rtapi_callback_t api_callback_fun = NULL;
+  void* api_callback_arg = NULL;
+  cb_table->get(API_ID_hsa_signal_load_relaxed, &api_callback_fun, &api_callback_arg);
+  api_data.phase = 0;
+  if (api_callback_fun) api_callback_fun(0, API_ID_hsa_signal_load_relaxed, &api_data, api_callback_arg);
+  int64_t ret = hsa_signal_load_relaxed_fn(signal);
+  api_data.retval = ret;
+  api_data.phase = 1;
+  if (api_callback_fun) api_callback_fun(0, API_ID_hsa_signal_load_relaxed, &api_data, api_callback_arg);
+  return ret;
+}
+
+template <class Table>
+double run(Table* cb_table, uint32_t thread_count, uint64_t call_count) {
+  signal_t signal{1};
+  const auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([cb_table, &signal, call_count]() {
+      int64_t sum = 0;
+      for (uint64_t i = 0; i < call_count; ++i) sum += hsa_signal_load_relaxed_callback(cb_table, &signal);
+      if (sum != (int64_t)call_count) abort();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  return thread_count * call_count / sec / 1e6;
+}
+
+int main(int argc, char** argv) {
+  const uint64_t call_count = (argc > 1) ? atoll(argv[1]) : 10000000;
+  const uint32_t thread_max = (argc > 2) ? atoi(argv[2]) : 16;
+
+  LockedCbTable* locked_table = new LockedCbTable;
+  roctracer::CbTable<API_ID_NUMBER>* table = new roctracer::CbTable<API_ID_NUMBER>;
+
+  printf("calls per thread(%lu), Mcalls/s\n", (unsigned long)call_count);
+  printf("%8s %12s %12s %12s %12s\n", "threads", "locked", "atomic", "locked+cb", "atomic+cb");
+  for (uint32_t thread_count = 1; thread_count <= thread_max; thread_count *= 2) {
+    locked_table->set(API_ID_hsa_signal_load_relaxed, NULL, NULL);
+    table->set(API_ID_hsa_signal_load_relaxed, NULL, NULL);
+    const double locked = run(locked_table, thread_count, call_count);
+    const double atomic = run(table, thread_count, call_count);
+    locked_table->set(API_ID_hsa_signal_load_relaxed, api_callback, NULL);
+    table->set(API_ID_hsa_signal_load_relaxed, api_callback, NULL);
+    const double locked_cb = run(locked_table, thread_count, call_count);
+    const double atomic_cb = run(table, thread_count, call_count);
+    printf("%8u %12.1f %12.1f %12.1f %12.1f\n", thread_count, locked, atomic, locked_cb, atomic_cb);
+  }
+
+  delete table;
+  delete locked_table;
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Correlation id generation scaling benchmark
+//
+// correlation_id_bench <cycles per thread> <max threads>
+// HIP_SyncActivityCallback style enter/exit cycles, the enter generates a correlation id
+// and pushes a record on the thread local stack, the exit pops it. The previous mutex
+// guarded counter is compared with the per-thread batched one for 1..max threads.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stack>
+#include <thread>
+#include <vector>
+
+#include "inc/roctracer.h"
+#include "core/global_counter.h"
+
+namespace roctracer {
+std::atomic<GlobalCounter::counter_t> GlobalCounter::counter_(0);
+thread_local GlobalCounter::counter_t GlobalCounter::next_ = 0;
+thread_local GlobalCounter::counter_t GlobalCounter::end_ = 0;
+}  // namespace roctracer
+
+// Previous mutex guarded counter
+class LockedCounter {
+  public:
+  typedef uint64_t counter_t;
+
+  static counter_t Increment() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ++counter_;
+  }
+
+  private:
+  static std::mutex mutex_;
+  static counter_t counter_;
+};
+std::mutex LockedCounter::mutex_;
+LockedCounter::counter_t LockedCounter::counter_ = 0;
+
+static thread_local std::stack<roctracer_record_t> record_stack;
+
+template <class Counter>
+double run(uint32_t thread_count, uint64_t cycle_count) {
+  std::atomic<uint64_t> checksum{0};
+  const auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&checksum, cycle_count]() {
+      uint64_t sum = 0;
+      uint64_t last = 0;
+      for (uint64_t i = 0; i < cycle_count; ++i) {
+        // Enter
+        record_stack.push({});
+        roctracer_record_t& record = record_stack.top();
+        record.correlation_id = Counter::Increment();
+        if (record.correlation_id <= last) abort();
+        last = record.correlation_id;
+        // Exit
+        sum += record_stack.top().correlation_id;
+        record_stack.pop();
+      }
+      checksum.fetch_add(sum, std::memory_order_relaxed);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  return thread_count * cycle_count / sec / 1e6;
+}
+
+int main(int argc, char** argv) {
+  const uint64_t cycle_count = (argc > 1) ? atoll(argv[1]) : 1000000;
+  const uint32_t thread_max = (argc > 2) ? atoi(argv[2]) : 64;
+
+  printf("cycles per thread(%lu), Mcycles/s\n", (unsigned long)cycle_count);
+  printf("%8s %12s %12s\n", "threads", "locked", "batched");
+  for (uint32_t thread_count = 1; thread_count <= thread_max; thread_count *= 2) {
+    const double locked = run<LockedCounter>(thread_count, cycle_count);
+    const double batched = run<roctracer::GlobalCounter>(thread_count, cycle_count);
+    printf("%8u %12.1f %12.1f\n", thread_count, locked, batched);
+  }
+  return 0;
+}
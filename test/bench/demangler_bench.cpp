@@ -0,0 +1,105 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+////////////////////////////////////////////////////////////////////////////////
+//
+// Kernel names demangling benchmark
+//
+// demangler_bench <records> <distinct names>
+// The output of the kernel launch records is modeled, the previous per record
+// __cxa_demangle is compared with the shared demangler cache, and the demangling of
+// the distinct names set is done serially and in parallel before the output.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cxxabi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "util/demangler.h"
+
+typedef roctracer::util::Demangler demangler_t;
+
+// Previous per record demangling
+const char* cxx_demangle(const char* symbol) {
+  size_t funcnamesize;
+  int status;
+  const char* ret = (symbol != NULL) ? abi::__cxa_demangle(symbol, NULL, &funcnamesize, &status) : symbol;
+  return (ret != NULL) ? ret : symbol;
+}
+
+double elapsed(const std::chrono::steady_clock::time_point& begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char** argv) {
+  const uint64_t record_count = (argc > 1) ? atoll(argv[1]) : 1000000;
+  const uint32_t name_count = (argc > 2) ? atoi(argv[2]) : 2000;
+
+  // Templated kernel names
+  std::vector<std::string> names(name_count);
+  for (uint32_t n = 0; n < name_count; ++n) {
+    const std::string id = "kernel_" + std::to_string(n);
+    names[n] = "_Z" + std::to_string(id.size()) + id + "IfLi256EEvPKT_PS0_i";
+  }
+  std::vector<const char*> records(record_count);
+  for (uint64_t i = 0; i < record_count; ++i) records[i] = names[(i * 7919) % name_count].c_str();
+
+  uint64_t length = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (const char* name : records) {
+    const char* demangled = cxx_demangle(name);
+    length += strlen(demangled);
+    if (demangled != name) free(const_cast<char*>(demangled));
+  }
+  const double per_record = record_count / elapsed(begin) / 1e6;
+
+  demangler_t* cached = new demangler_t(demangler_t::CAPACITY, false);
+  begin = std::chrono::steady_clock::now();
+  for (const char* name : records) length -= cached->Demangle(name).size();
+  const double cached_rate = record_count / elapsed(begin) / 1e6;
+  if (length != 0) abort();
+
+  std::vector<const char*> distinct(name_count);
+  for (uint32_t n = 0; n < name_count; ++n) distinct[n] = names[n].c_str();
+  demangler_t* serial = new demangler_t(demangler_t::CAPACITY, false);
+  begin = std::chrono::steady_clock::now();
+  for (const char* name : distinct) serial->Demangle(name);
+  const double serial_ms = elapsed(begin) * 1e3;
+  demangler_t* parallel = new demangler_t(demangler_t::CAPACITY, true);
+  begin = std::chrono::steady_clock::now();
+  parallel->DemangleAll(distinct);
+  const double parallel_ms = elapsed(begin) * 1e3;
+
+  printf("records(%lu) names(%u)\n", (unsigned long)record_count, name_count);
+  printf("output, Mrecords/s: per-record %.2f, cached %.2f\n", per_record, cached_rate);
+  printf("distinct names demangling, ms: serial %.2f, parallel %.2f\n", serial_ms, parallel_ms);
+  printf("'%s' base name '%s'\n", serial->Demangle(distinct[0]).c_str(), parallel->Demangle(distinct[0]).c_str());
+
+  delete parallel;
+  delete serial;
+  delete cached;
+  return 0;
+}
@@ -0,0 +1,143 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Trace entry false sharing benchmark
+//
+// false_sharing_bench <entries> <thread pairs>
+// Each pair runs a submitting thread filling the entries as Tracker::Enable does
+// and a completing thread following it as Tracker::Complete does. The legacy packed entry
+// layout is compared with the split trace_entry_t, which keeps the completion fields on their
+// own cache line and the entry states in a dense state map, as the trace buffer chunks do.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "core/trace_buffer.h"
+
+static const size_t CACHE_LINE_SIZE = 64;
+
+// Previous packed layout, the completion fields are next to the submit ones
+struct packed_entry_t {
+  std::atomic<uint32_t> valid;
+  uint32_t type;
+  uint64_t dispatch;
+  uint64_t begin;
+  uint64_t end;
+  uint64_t complete;
+  hsa_agent_t agent;
+  uint32_t dev_index;
+  hsa_signal_t orig;
+  hsa_signal_t signal;
+  struct {
+    uint32_t name_id;
+    uint32_t tid;
+    hsa_agent_t agent;
+  } kernel;
+};
+
+template <class Entry>
+void submit(Entry* entry, uint64_t index) {
+  entry->type = roctracer::KERNEL_ENTRY_TYPE;
+  entry->agent.handle = index;
+  entry->orig.handle = 0;
+  entry->signal.handle = index;
+  entry->kernel.name_id = 0;
+  entry->kernel.tid = index;
+  entry->dispatch = index;
+  entry->valid.store(roctracer::TRACE_ENTRY_INIT, std::memory_order_release);
+}
+
+template <class Entry>
+void complete(Entry* entry) {
+  while (entry->valid.load(std::memory_order_acquire) != roctracer::TRACE_ENTRY_INIT) sched_yield();
+  entry->begin = entry->dispatch + 1;
+  entry->end = entry->dispatch + 2;
+  entry->dev_index = 0;
+  entry->complete = entry->dispatch + 3;
+  entry->valid.store(roctracer::TRACE_ENTRY_COMPL, std::memory_order_release);
+}
+
+// Entry state initialization, the split entries states are kept in the state map
+void init_entry(packed_entry_t* entry, std::atomic<uint8_t>*) {
+  entry->valid.store(roctracer::TRACE_ENTRY_FREE, std::memory_order_relaxed);
+}
+void init_entry(roctracer::trace_entry_t* entry, std::atomic<uint8_t>* state) {
+  state->store(roctracer::TRACE_ENTRY_FREE, std::memory_order_relaxed);
+  entry->valid.bind(state);
+}
+
+template <class Entry>
+double run(const char* name, uint64_t entry_count, uint32_t pair_count) {
+  void* ptr = NULL;
+  if (posix_memalign(&ptr, CACHE_LINE_SIZE, entry_count * pair_count * sizeof(Entry)) != 0) abort();
+  Entry* entries = (Entry*)ptr;
+  std::vector<std::atomic<uint8_t>> states(entry_count * pair_count);
+  for (uint64_t i = 0; i < entry_count * pair_count; ++i) init_entry(entries + i, &states[i]);
+
+  const auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (uint32_t p = 0; p < pair_count; ++p) {
+    Entry* pair_entries = entries + p * entry_count;
+    threads.emplace_back([pair_entries, entry_count]() {
+      for (uint64_t i = 0; i < entry_count; ++i) submit(pair_entries + i, i);
+    });
+    threads.emplace_back([pair_entries, entry_count]() {
+      for (uint64_t i = 0; i < entry_count; ++i) complete(pair_entries + i);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  uint64_t errors = 0;
+  for (uint64_t i = 0; i < entry_count * pair_count; ++i) {
+    if (entries[i].valid.load(std::memory_order_relaxed) != roctracer::TRACE_ENTRY_COMPL) errors += 1;
+  }
+  free(ptr);
+  if (errors != 0) {
+    fprintf(stderr, "%s: %lu entries not completed\n", name, (unsigned long)errors);
+    abort();
+  }
+
+  const double rate = entry_count * pair_count / sec / 1e6;
+  printf("  %s entry(%zu bytes): %.1f Mentries/s\n", name, sizeof(Entry), rate);
+  return rate;
+}
+
+int main(int argc, char** argv) {
+  const uint64_t entry_count = (argc > 1) ? atoll(argv[1]) : 10000000;
+  const uint32_t pair_count = (argc > 2) ? atoi(argv[2]) : 1;
+
+  printf("entries(%lu) pairs(%u):\n", (unsigned long)entry_count, pair_count);
+  run<packed_entry_t>("packed", entry_count, pair_count);
+  run<roctracer::trace_entry_t>("split", entry_count, pair_count);
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// HIP activity enter/exit path benchmark
+//
+// hip_activity_bench <cycles> <nesting depth>
+// HIP_SyncActivityCallback style enter/exit cycles. The previous path with the std::stack
+// records and the pid/tid syscalls is compared with the fixed capacity record stack and
+// the cached ids. The heap allocations and the syscalls are counted by the hooks below
+// after a warm up cycle.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stack>
+
+#include "inc/roctracer.h"
+#include "core/record_stack.h"
+#include "util/thread_ids.h"
+
+std::atomic<uint64_t> alloc_count{0};
+std::atomic<uint64_t> syscall_count{0};
+
+// Allocation counting hook
+void* operator new(size_t size) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = malloc(size);
+  if (ptr == NULL) throw std::bad_alloc();
+  return ptr;
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+
+// Syscall counting hook
+extern "C" long syscall(long number, ...) {
+  typedef long (*syscall_fn_t)(long, ...);
+  static syscall_fn_t syscall_fn = (syscall_fn_t)dlsym(RTLD_NEXT, "syscall");
+  syscall_count.fetch_add(1, std::memory_order_relaxed);
+  va_list args;
+  va_start(args, number);
+  long arg[6];
+  for (int i = 0; i < 6; ++i) arg[i] = va_arg(args, long);
+  va_end(args);
+  return syscall_fn(number, arg[0], arg[1], arg[2], arg[3], arg[4], arg[5]);
+}
+
+struct record_pair_t {
+  roctracer_record_t record;
+  char data[256];
+};
+
+static thread_local std::stack<record_pair_t> legacy_stack;
+static thread_local roctracer::RecordStack<record_pair_t, 32> record_stack;
+
+uint64_t checksum = 0;
+
+void legacy_cycle(uint32_t depth) {
+  for (uint32_t i = 0; i < depth; ++i) {
+    legacy_stack.push({});
+    legacy_stack.top().record.correlation_id = i;
+  }
+  for (uint32_t i = 0; i < depth; ++i) {
+    roctracer_record_t& record = legacy_stack.top().record;
+    record.process_id = syscall(__NR_getpid);
+    record.thread_id = syscall(__NR_gettid);
+    checksum += record.correlation_id + record.thread_id;
+    legacy_stack.pop();
+  }
+}
+
+void cycle(uint32_t depth) {
+  for (uint32_t i = 0; i < depth; ++i) {
+    roctracer_record_t* record = &(record_stack.push()->record);
+    *record = {};
+    record->correlation_id = i;
+  }
+  for (uint32_t i = 0; i < depth; ++i) {
+    roctracer_record_t& record = record_stack.top().record;
+    record.process_id = roctracer::util::ThreadIds::Pid();
+    record.thread_id = roctracer::util::ThreadIds::Tid();
+    checksum += record.correlation_id + record.thread_id;
+    record_stack.pop();
+  }
+}
+
+template <class F>
+void run(const char* name, F fun, uint64_t cycle_count, uint32_t depth) {
+  fun(depth);
+  const uint64_t alloc_begin = alloc_count.load();
+  const uint64_t syscall_begin = syscall_count.load();
+  const auto begin = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < cycle_count; ++i) fun(depth);
+  const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  printf("  %-8s %8.1f Mcalls/s, %lu allocations, %lu syscalls\n", name,
+    cycle_count * depth / sec / 1e6,
+    (unsigned long)(alloc_count.load() - alloc_begin), (unsigned long)(syscall_count.load() - syscall_begin));
+}
+
+int main(int argc, char** argv) {
+  const uint64_t cycle_count = (argc > 1) ? atoll(argv[1]) : 1000000;
+  const uint32_t depth = (argc > 2) ? atoi(argv[2]) : 1;
+
+  roctracer::util::ThreadIds::Init();
+  printf("cycles(%lu) depth(%u):\n", (unsigned long)cycle_count, depth);
+  run("legacy", legacy_cycle, cycle_count, depth);
+  run("fixed", cycle, cycle_count, depth);
+  return 0;
+}
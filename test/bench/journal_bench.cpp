@@ -0,0 +1,174 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Tracing start/stop toggling benchmark
+//
+// journal_bench <toggles>
+// The roctracer_start/stop replay of the enabled ops journal is modeled for the HSA API
+// domain, registered in the callbacks table, and the HIP API domain, registered per op
+// by the runtime. The previous map journal is compared with the dense journal with the
+// ops enabled one by one and with the domains enabled as a whole.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+
+#include "cb_table.h"
+#include "core/journal.h"
+
+enum {
+  DOMAIN_HSA_API = 1,
+  DOMAIN_HIP_API = 3,
+};
+static const uint32_t HSA_API_ID_NUMBER = 192;
+static const uint32_t HIP_API_ID_NUMBER = 320;
+
+// Previous map journal
+template <class Data>
+class MapJournal {
+  public:
+  typedef std::map<uint32_t, Data> domain_map_t;
+  typedef std::map<uint32_t, domain_map_t> journal_map_t;
+
+  struct record_t {
+    uint32_t domain;
+    uint32_t op;
+    Data data;
+  };
+
+  void registr(const record_t& record) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    map_[record.domain].insert({record.op, record.data});
+  }
+
+  template <class F>
+  F foreach(const F& f_i) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    F f = f_i;
+    for (auto& domain : map_) {
+      for (auto& op : domain.second) f.fun({domain.first, op.first, op.second});
+    }
+    return f;
+  }
+
+  private:
+  journal_map_t map_;
+  std::mutex mutex_;
+};
+
+struct cb_data_t {
+  activity_rtapi_callback_t callback;
+  void* user_data;
+};
+
+roctracer::CbTable<HSA_API_ID_NUMBER> cb_table;
+volatile uint64_t hip_registered = 0;
+
+void api_callback(uint32_t domain, uint32_t cid, const void* data, void* arg) {
+  (void)domain;
+  (void)cid;
+  (void)data;
+  (void)arg;
+}
+
+// Runtime per op registration
+__attribute__((noinline)) void hip_register(uint32_t op, bool enable) {
+  (void)op;
+  hip_registered = hip_registered + (enable ? 1 : -1);
+}
+
+void enable_op(uint32_t domain, uint32_t op, const cb_data_t& data, bool enable) {
+  if (domain == DOMAIN_HSA_API) cb_table.set(op, enable ? data.callback : NULL, data.user_data);
+  else hip_register(op, enable);
+}
+
+void enable_domain(uint32_t domain, const cb_data_t& data, bool enable) {
+  if (domain == DOMAIN_HSA_API) {
+    cb_table.set_all(enable ? data.callback : NULL, data.user_data);
+  } else {
+    for (uint32_t op = 0; op < HIP_API_ID_NUMBER; op++) hip_register(op, enable);
+  }
+}
+
+template <class T>
+struct functor_t {
+  bool enable;
+  bool fun(const typename T::record_t& record) {
+    enable_op(record.domain, record.op, record.data, enable);
+    return true;
+  }
+  bool fun_domain(const uint32_t& domain, const cb_data_t& data) {
+    enable_domain(domain, data, enable);
+    return true;
+  }
+};
+
+template <class T>
+double run(T* journal, uint64_t toggle_count) {
+  const auto begin = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < toggle_count; ++i) {
+    journal->foreach(functor_t<T>{true});
+    journal->foreach(functor_t<T>{false});
+  }
+  const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  if (hip_registered != 0) abort();
+  return toggle_count / sec;
+}
+
+int main(int argc, char** argv) {
+  const uint64_t toggle_count = (argc > 1) ? atoll(argv[1]) : 100000;
+  const cb_data_t data{api_callback, NULL};
+
+  MapJournal<cb_data_t>* map_journal = new MapJournal<cb_data_t>;
+  roctracer::Journal<cb_data_t>* op_journal = new roctracer::Journal<cb_data_t>;
+  roctracer::Journal<cb_data_t>* domain_journal = new roctracer::Journal<cb_data_t>;
+  for (uint32_t op = 0; op < HSA_API_ID_NUMBER; op++) {
+    map_journal->registr({DOMAIN_HSA_API, op, data});
+    op_journal->registr({DOMAIN_HSA_API, op, data});
+  }
+  for (uint32_t op = 0; op < HIP_API_ID_NUMBER; op++) {
+    map_journal->registr({DOMAIN_HIP_API, op, data});
+    op_journal->registr({DOMAIN_HIP_API, op, data});
+  }
+  domain_journal->registr_domain(DOMAIN_HSA_API, HSA_API_ID_NUMBER, data);
+  domain_journal->registr_domain(DOMAIN_HIP_API, HIP_API_ID_NUMBER, data);
+
+  const double map_rate = run(map_journal, toggle_count);
+  const double op_rate = run(op_journal, toggle_count);
+  const double domain_rate = run(domain_journal, toggle_count);
+  printf("start/stop toggles(%lu), toggles/s\n", (unsigned long)toggle_count);
+  printf("%12s %12s %12s\n", "map", "dense", "domain");
+  printf("%12.0f %12.0f %12.0f\n", map_rate, op_rate, domain_rate);
+
+  delete domain_journal;
+  delete op_journal;
+  delete map_journal;
+  return 0;
+}
@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Activity pool write throughput benchmark
+//
+// pool_bench <threads> <records per thread> <pool mode> <huge pages>
+// The TLB misses can be collected with 'perf stat -e dTLB-load-misses,dTLB-store-misses'
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "inc/roctracer.h"
+#include "core/memory_pool.h"
+
+std::atomic<uint64_t> read_count{0};
+
+void buffer_callback(const char* begin, const char* end, void* arg) {
+  (void)arg;
+  read_count.fetch_add((end - begin) / sizeof(roctracer_record_t), std::memory_order_relaxed);
+}
+
+int main(int argc, char** argv) {
+  const uint32_t thread_count = (argc > 1) ? atoi(argv[1]) : 8;
+  const uint64_t record_count = (argc > 2) ? atoll(argv[2]) : 1000000;
+  const uint32_t mode = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : (uint32_t)ROCTRACER_POOL_MODE_THREAD_CHUNKS;
+  const bool huge_pages = (argc > 4) ? (atoi(argv[4]) != 0) : false;
+
+  roctracer_properties_t properties{};
+  properties.mode = mode;
+  properties.buffer_size = 0x1000000;
+  properties.buffer_count = 4;
+  properties.buffer_callback_fun = buffer_callback;
+  properties.drain_timeout = UINT32_MAX;
+  if (huge_pages) properties.alloc_fun = roctracer::util::HugePageAllocator::allocator;
+  roctracer::MemoryPool* pool = new roctracer::MemoryPool(properties);
+
+  const auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([pool, record_count, t]() {
+      roctracer_record_t record{};
+      record.thread_id = t;
+      for (uint64_t i = 0; i < record_count; ++i) {
+        record.correlation_id = i;
+        pool->Write(record);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  pool->Flush();
+  const auto end = std::chrono::steady_clock::now();
+  delete pool;
+
+  const double sec = std::chrono::duration<double>(end - begin).count();
+  const uint64_t total = thread_count * record_count;
+  printf("threads(%u) mode(0x%x) huge-pages(%d): %lu records, %.1f Mrec/s, %.1f MB/s\n",
+    thread_count, mode, (int)huge_pages, (unsigned long)read_count.load(),
+    total / sec / 1e6, total * sizeof(roctracer_record_t) / sec / 1e6);
+  return (read_count.load() == total) ? 0 : 1;
+}
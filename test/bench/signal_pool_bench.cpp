@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Proxy signal pool benchmark
+//
+// signal_pool_bench <signals per thread> <max threads>
+// The tracker proxy signal churn, a signal created and destroyed per tracked dispatch,
+// is compared with the pooled signals for 1..max threads. The HSA signal API is modeled
+// by a CPU stand-in, the interrupt signal creation allocates a driver event, an eventfd
+// is created and closed in its place.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "proxy/signal_pool.h"
+
+// CPU stand-in of the HSA signal API
+struct CpuSignalApi {
+  struct signal_t {
+    std::atomic<int64_t> value;
+    int event;
+  };
+
+  static hsa_status_t Create(hsa_signal_t* signal) {
+    signal_t* ptr = new signal_t;
+    ptr->value.store(1, std::memory_order_relaxed);
+    ptr->event = eventfd(0, 0);
+    if (ptr->event < 0) abort();
+    signal->handle = reinterpret_cast<uint64_t>(ptr);
+    return HSA_STATUS_SUCCESS;
+  }
+  static void Reset(const hsa_signal_t& signal) {
+    reinterpret_cast<signal_t*>(signal.handle)->value.store(1, std::memory_order_relaxed);
+  }
+  static void Destroy(const hsa_signal_t& signal) {
+    signal_t* ptr = reinterpret_cast<signal_t*>(signal.handle);
+    close(ptr->event);
+    delete ptr;
+  }
+};
+
+typedef proxy::AgentSignalPools<CpuSignalApi> pools_t;
+typedef pools_t::pool_t pool_t;
+
+// Signals in flight per thread
+static const uint32_t INFLIGHT = 8;
+
+template <class Fun>
+double run(uint32_t thread_count, uint64_t signal_count, Fun fun) {
+  const auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) threads.emplace_back(fun);
+  for (auto& thread : threads) thread.join();
+  const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  return thread_count * signal_count / sec / 1e6;
+}
+
+int main(int argc, char** argv) {
+  const uint64_t signal_count = (argc > 1) ? atoll(argv[1]) : 2000000;
+  const uint32_t thread_max = (argc > 2) ? atoi(argv[2]) : 16;
+
+  printf("signals per thread(%lu), Msignals/s\n", (unsigned long)signal_count);
+  printf("%8s %12s %12s %12s %12s\n", "threads", "create", "pooled", "hits", "misses");
+  for (uint32_t thread_count = 1; thread_count <= thread_max; thread_count *= 2) {
+    const double create = run(thread_count, signal_count, [signal_count]() {
+      hsa_signal_t signal_arr[INFLIGHT];
+      for (uint64_t i = 0; i < signal_count; ++i) {
+        const uint32_t slot = i % INFLIGHT;
+        if (i >= INFLIGHT) CpuSignalApi::Destroy(signal_arr[slot]);
+        CpuSignalApi::Create(&signal_arr[slot]);
+      }
+      for (uint32_t slot = 0; slot < INFLIGHT; ++slot) CpuSignalApi::Destroy(signal_arr[slot]);
+    });
+
+    pools_t* pools = new pools_t;
+    const double pooled = run(thread_count, signal_count, [pools, signal_count]() {
+      pool_t* pool = pools->Get(hsa_agent_t{0});
+      hsa_signal_t signal_arr[INFLIGHT];
+      pool_t::index_t index_arr[INFLIGHT];
+      for (uint64_t i = 0; i < signal_count; ++i) {
+        const uint32_t slot = i % INFLIGHT;
+        if (i >= INFLIGHT) pool->Release(index_arr[slot]);
+        index_arr[slot] = pool->Acquire(&signal_arr[slot]);
+        if (index_arr[slot] == pool_t::INDEX_NIL) abort();
+      }
+      for (uint32_t slot = 0; slot < INFLIGHT; ++slot) pool->Release(index_arr[slot]);
+    });
+    pool_t::stats_t stats{};
+    pools->GetStats(&stats);
+    delete pools;
+
+    printf("%8u %12.1f %12.1f %12lu %12lu\n", thread_count, create, pooled,
+      (unsigned long)stats.hits, (unsigned long)stats.misses);
+  }
+  return 0;
+}
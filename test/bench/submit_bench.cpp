@@ -0,0 +1,213 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Intercepted packets submit path benchmark
+//
+// submit_bench <submits> <packets per submit> <distinct kernels>
+// Synthetic kernel dispatch packet arrays are replayed through the intercept queue submit
+// callback, modeled as before and as batched, with a stub packet writer. The loader host
+// address query is modeled by a locked map lookup, the trackers are completed at once.
+// The previous callback copies the kernel name per dispatch, the batched one interns it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "core/trace_buffer.h"
+#include "proxy/kernel_cache.h"
+#include "util/name_table.h"
+#include "util/thread_ids.h"
+
+typedef roctracer::trace_entry_t entry_t;
+typedef hsa_kernel_dispatch_packet_t packet_t;
+typedef void (*writer_t)(const void* packets, uint64_t count);
+
+static const uint32_t SUBMIT_BATCH_SIZE = 64;
+
+struct kernel_t {
+  alignas(64) uint64_t kernel_symbol;
+  const char* name;
+};
+
+std::map<uint64_t, const kernel_t*> loader_map;
+std::mutex loader_mutex;
+uint64_t written_count = 0;
+uint64_t flushed_count = 0;
+// Per dispatch name copies of the previous callback, never freed by the tracer
+std::vector<char*> name_copies;
+uint64_t name_copies_size = 0;
+
+// Loader host address query
+uint64_t loader_query(const uint64_t kernel_object) {
+  std::lock_guard<std::mutex> lck(loader_mutex);
+  return loader_map.find(kernel_object)->second->kernel_symbol;
+}
+
+uint64_t resolve_name_id(const uint64_t kernel_object) {
+  const kernel_t* kernel = reinterpret_cast<const kernel_t*>(loader_query(kernel_object));
+  return roctracer::util::NameTable::Instance()->Intern(kernel->name);
+}
+
+void stub_writer(const void* packets, uint64_t count) {
+  (void)packets;
+  written_count += count;
+}
+
+void kernel_flush(entry_t* entry) {
+  (void)entry;
+  flushed_count += 1;
+}
+
+roctracer::TraceBuffer<entry_t>::flush_prm_t flush_prm[] = {{roctracer::KERNEL_ENTRY_TYPE, kernel_flush}};
+
+uint64_t timestamp_ns() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+bool is_dispatch(const packet_t* packet) {
+  return ((packet->header >> HSA_PACKET_HEADER_TYPE) & ((1u << HSA_PACKET_HEADER_WIDTH_TYPE) - 1)) ==
+    HSA_PACKET_TYPE_KERNEL_DISPATCH;
+}
+
+void enable(entry_t* entry, const hsa_signal_t& signal, uint64_t dispatch) {
+  entry->type = roctracer::KERNEL_ENTRY_TYPE;
+  entry->orig = signal;
+  entry->dispatch = dispatch;
+  entry->begin = dispatch;
+  entry->end = dispatch;
+  entry->valid.store(roctracer::TRACE_ENTRY_COMPL, std::memory_order_release);
+}
+
+// Previous packet by packet submit callback
+void submit_packets(roctracer::TraceBuffer<entry_t>* buffer, packet_t* packets, uint64_t count, writer_t writer) {
+  for (uint64_t j = 0; j < count; ++j) {
+    packet_t* packet = &packets[j];
+    if (is_dispatch(packet)) {
+      const kernel_t* kernel = reinterpret_cast<const kernel_t*>(loader_query(packet->kernel_object));
+      entry_t* entry = buffer->GetEntry();
+      entry->kernel.tid = syscall(__NR_gettid);
+      char* name = strdup(kernel->name);
+      name_copies.push_back(name);
+      name_copies_size += strlen(name) + 1;
+      entry->kernel.name_id = 0;
+      enable(entry, packet->completion_signal, timestamp_ns());
+    }
+  }
+  writer(packets, count);
+}
+
+// Batched submit callback
+void submit_batched(roctracer::TraceBuffer<entry_t>* buffer, packet_t* packets, uint64_t count, writer_t writer) {
+  const uint32_t tid = roctracer::util::ThreadIds::Tid();
+  packet_t* dispatch_arr[SUBMIT_BATCH_SIZE];
+  entry_t* entry_arr[SUBMIT_BATCH_SIZE];
+  for (uint64_t begin = 0; begin < count; begin += SUBMIT_BATCH_SIZE) {
+    const uint64_t end = (begin + SUBMIT_BATCH_SIZE < count) ? begin + SUBMIT_BATCH_SIZE : count;
+    uint32_t dispatch_count = 0;
+    for (uint64_t j = begin; j < end; ++j) {
+      if (is_dispatch(&packets[j])) dispatch_arr[dispatch_count++] = &packets[j];
+    }
+    if (dispatch_count == 0) continue;
+
+    buffer->GetEntries(entry_arr, dispatch_count);
+    const uint64_t dispatch = timestamp_ns();
+    for (uint32_t i = 0; i < dispatch_count; ++i) {
+      entry_arr[i]->kernel.name_id = proxy::KernelCache::Lookup(dispatch_arr[i]->kernel_object, resolve_name_id);
+      entry_arr[i]->kernel.tid = tid;
+      enable(entry_arr[i], dispatch_arr[i]->completion_signal, dispatch);
+    }
+  }
+  writer(packets, count);
+}
+
+template <class Fun>
+double run(Fun submit, std::vector<packet_t>* packets, uint64_t submit_count, uint32_t packet_count) {
+  roctracer::TraceBuffer<entry_t>* buffer = new roctracer::TraceBuffer<entry_t>("bench", 0x10000, flush_prm, 1);
+  written_count = 0;
+  flushed_count = 0;
+  const auto begin = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < submit_count; ++i) {
+    packet_t* arr = packets->data() + (i * packet_count) % (packets->size() - packet_count + 1);
+    submit(buffer, arr, packet_count, stub_writer);
+  }
+  const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  delete buffer;
+  if (written_count != submit_count * packet_count) abort();
+  return written_count / sec / 1e6;
+}
+
+int main(int argc, char** argv) {
+  const uint64_t submit_count = (argc > 1) ? atoll(argv[1]) : 100000;
+  const uint32_t packet_count = (argc > 2) ? atoi(argv[2]) : 16;
+  const uint32_t kernel_count = (argc > 3) ? atoi(argv[3]) : 32;
+
+  // Loaded kernels, the kernel object is mapped to the kernel itself as its symbol
+  std::vector<kernel_t> kernels(kernel_count);
+  std::vector<uint64_t> kernel_objects(kernel_count);
+  std::vector<char*> names(kernel_count);
+  for (uint32_t k = 0; k < kernel_count; ++k) {
+    names[k] = (char*)malloc(64);
+    snprintf(names[k], 64, "_Z13synthetic_kernel%uPfS_i", k);
+    kernels[k].kernel_symbol = reinterpret_cast<uint64_t>(&kernels[k]);
+    kernels[k].name = names[k];
+    kernel_objects[k] = reinterpret_cast<uint64_t>(&kernels[k]);
+    loader_map[kernel_objects[k]] = &kernels[k];
+  }
+
+  // Packets stream, every 8th packet is a barrier
+  std::vector<packet_t> packets(packet_count * 64);
+  for (uint64_t j = 0; j < packets.size(); ++j) {
+    packet_t& packet = packets[j];
+    memset(&packet, 0, sizeof(packet));
+    packet.header = ((j % 8) == 7) ? HSA_PACKET_TYPE_BARRIER_AND : HSA_PACKET_TYPE_KERNEL_DISPATCH;
+    packet.kernel_object = kernel_objects[(j * 7) % kernel_count];
+  }
+
+  const double packet_rate = run(submit_packets, &packets, submit_count, packet_count);
+  const double batched_rate = run(submit_batched, &packets, submit_count, packet_count);
+  printf("submits(%lu) packets per submit(%u) kernels(%u), Mpackets/s\n",
+    (unsigned long)submit_count, packet_count, kernel_count);
+  printf("%12s %12s\n", "per-packet", "batched");
+  printf("%12.2f %12.2f\n", packet_rate, batched_rate);
+  printf("kernel names kept: per-packet %lu copies (%lu bytes), batched %u interned\n",
+    (unsigned long)name_copies.size(), (unsigned long)name_copies_size,
+    roctracer::util::NameTable::Instance()->Count());
+
+  for (char* name : names) free(name);
+  for (char* name : name_copies) free(name);
+  return 0;
+}
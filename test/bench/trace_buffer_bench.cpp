@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Trace buffer flush throughput benchmark
+//
+// trace_buffer_bench <entries> <entry types>
+// The trace buffer write and streaming flush throughput is measured, then the single
+// pass type-indexed dispatch is compared with the per-type passes over flat entries.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "core/trace_buffer.h"
+
+struct bench_entry_t {
+  roctracer::trace_state_t valid;
+  uint32_t type;
+  uint64_t begin;
+  uint64_t end;
+  uint64_t data[5];
+};
+
+typedef roctracer::TraceBuffer<bench_entry_t> bench_buffer_t;
+
+uint64_t flush_count = 0;
+uint64_t flush_sum = 0;
+
+void flush_cb(bench_entry_t* entry) {
+  flush_count += 1;
+  flush_sum += entry->end - entry->begin;
+}
+
+double elapsed(const std::chrono::steady_clock::time_point& begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, char** argv) {
+  const uint64_t entry_count = (argc > 1) ? atoll(argv[1]) : 20000000;
+  const uint32_t type_count = (argc > 2) ? atoi(argv[2]) : 3;
+
+  std::vector<bench_buffer_t::flush_prm_t> flush_prm(type_count);
+  for (uint32_t type = 0; type < type_count; ++type) flush_prm[type] = {type, flush_cb};
+
+  // Single pass flush of the trace buffer
+  bench_buffer_t* buffer = new bench_buffer_t("bench", 0x200000, flush_prm.data(), type_count);
+  auto begin = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < entry_count; ++i) {
+    bench_entry_t* entry = buffer->GetEntry();
+    entry->type = i % type_count;
+    entry->begin = i;
+    entry->end = i + 1;
+    entry->valid.store(roctracer::TRACE_ENTRY_COMPL, std::memory_order_release);
+  }
+  buffer->Flush();
+  const double buffer_sec = elapsed(begin);
+  delete buffer;
+  const uint64_t buffer_count = flush_count;
+
+  // Single pass and per-type passes over the same flat entries
+  std::vector<bench_entry_t> entries(entry_count);
+  std::vector<std::atomic<uint8_t>> states(entry_count);
+  for (uint64_t i = 0; i < entry_count; ++i) {
+    entries[i].valid.bind(&states[i]);
+    entries[i].type = i % type_count;
+    entries[i].begin = i;
+    entries[i].end = i + 1;
+    entries[i].valid.store(roctracer::TRACE_ENTRY_COMPL, std::memory_order_relaxed);
+  }
+  std::vector<bench_buffer_t::callback_t> table(type_count, flush_cb);
+  flush_count = 0;
+  begin = std::chrono::steady_clock::now();
+  for (bench_entry_t& entry : entries) {
+    if (entry.valid.load(std::memory_order_acquire) == roctracer::TRACE_ENTRY_COMPL) table[entry.type](&entry);
+  }
+  const double single_sec = elapsed(begin);
+  const uint64_t single_count = flush_count;
+
+  flush_count = 0;
+  begin = std::chrono::steady_clock::now();
+  for (uint32_t type = 0; type < type_count; ++type) {
+    for (bench_entry_t& entry : entries) {
+      if ((entry.valid.load(std::memory_order_acquire) == roctracer::TRACE_ENTRY_COMPL) && (entry.type == type)) {
+        flush_cb(&entry);
+      }
+    }
+  }
+  const double passes_sec = elapsed(begin);
+  const uint64_t passes_count = flush_count;
+
+  printf("entries(%lu) types(%u): trace buffer write+flush %.1f Mentries/s\n",
+    (unsigned long)entry_count, type_count, buffer_count / buffer_sec / 1e6);
+  printf("  flush single pass %.1f Mentries/s, per-type passes %.1f Mentries/s\n",
+    single_count / single_sec / 1e6, passes_count / passes_sec / 1e6);
+  return ((buffer_count == entry_count) && (single_count == entry_count) && (passes_count == entry_count)) ? 0 : 1;
+}
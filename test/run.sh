@@ -93,11 +93,18 @@ export ROCP_AGENTS=1
 export ROCP_THRS=1
 
 eval_test "tool HSA test" ./test/hsa/ctrl
+eval_test "tool HSA completion harvester test" "ROCTRACER_COMPLETION_HARVESTER=1 ./test/hsa/ctrl"
 
 echo "<trace name=\"HSA\"><parameters api=\"hsa_agent_get_info, hsa_amd_memory_pool_allocate\"></parameters></trace>" > input.xml
 export ROCP_INPUT=input.xml
 eval_test "tool HSA test input" ./test/hsa/ctrl
 
+# Stress tests
+eval_test "correlation id map stress test" ./test/correlation_id_map_test
+eval_test "signal pool stress test" ./test/signal_pool_test
+eval_test "completion harvester stress test" ./test/completion_harvester_test
+eval_test "name table stress test" ./test/name_table_test
+
 #valgrind --leak-check=full $tbin
 #valgrind --tool=massif $tbin
 #ms_print massif.out.<N>
@@ -0,0 +1,163 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Completion harvester stress test
+//
+// completion_harvester_test <threads> <entries per thread>
+// The submitting threads add the entries to the harvesters of two agents, the device
+// thread completes their signals, backed by a CPU stand-in of the HSA signal API, in
+// a shuffled order. Every entry is checked to be harvested once and after completion.
+// A harvester is stopped with the entries in flight, the pending entries and the entries
+// added after the stop are checked to be detached without waiting and completed later.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "proxy/agent_table.h"
+#include "proxy/completion_harvester.h"
+
+// CPU stand-in of the HSA signal API
+struct CpuSignalApi {
+  static hsa_signal_value_t Load(const hsa_signal_t& signal) {
+    return reinterpret_cast<std::atomic<int64_t>*>(signal.handle)->load(std::memory_order_acquire);
+  }
+  static void Wait(const hsa_signal_t& signal, const uint64_t& timeout) {
+    const auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeout);
+    while ((Load(signal) >= 1) && (std::chrono::steady_clock::now() < end)) sched_yield();
+  }
+  static uint64_t WaitTimeout(const uint64_t& timeout_ns) { return timeout_ns; }
+};
+
+struct entry_t {
+  hsa_signal_t signal;
+  std::atomic<int64_t> value;
+  std::atomic<uint32_t> harvested;
+};
+
+std::atomic<uint64_t> harvest_count{0};
+std::atomic<uint64_t> errors{0};
+std::atomic<uint64_t> detach_count{0};
+
+struct Completer {
+  static void Harvest(hsa_signal_value_t signal_value, entry_t* entry) {
+    if (signal_value != 0) errors.fetch_add(1);
+    if (entry->value.load() != 0) errors.fetch_add(1);
+    if (entry->harvested.exchange(1) != 0) errors.fetch_add(1);
+    harvest_count.fetch_add(1);
+  }
+
+  // CPU stand-in of the signal async handler
+  static void Detach(entry_t* entry) {
+    detach_count.fetch_add(1);
+    std::thread([entry]() {
+      while (CpuSignalApi::Load(entry->signal) >= 1) sched_yield();
+      Harvest(CpuSignalApi::Load(entry->signal), entry);
+    }).detach();
+  }
+};
+
+typedef proxy::CompletionHarvester<entry_t, Completer, CpuSignalApi> harvester_t;
+typedef proxy::AgentTable<harvester_t> harvesters_t;
+
+static const uint32_t AGENT_COUNT = 2;
+static const uint32_t SHUFFLE_WINDOW = 8;
+static const uint32_t LATE_COUNT = 16;
+
+int main(int argc, char** argv) {
+  const uint32_t thread_count = (argc > 1) ? atoi(argv[1]) : 4;
+  const uint64_t entry_count = (argc > 2) ? atoll(argv[2]) : 100000;
+  const uint64_t total = thread_count * entry_count + LATE_COUNT;
+
+  std::vector<entry_t> entries(total);
+  for (entry_t& entry : entries) {
+    entry.value.store(1, std::memory_order_relaxed);
+    entry.harvested.store(0, std::memory_order_relaxed);
+    entry.signal.handle = reinterpret_cast<uint64_t>(&entry.value);
+  }
+
+  // Added entries queue, completed by the device thread
+  std::vector<std::atomic<entry_t*>> added(total);
+  for (auto& ptr : added) ptr.store(NULL, std::memory_order_relaxed);
+  std::atomic<uint64_t> add_index{0};
+
+  harvesters_t* harvesters = new harvesters_t;
+  const uint64_t added_total = total - LATE_COUNT;
+  std::thread device([&added, added_total]() {
+    for (uint64_t i = 0; i < added_total; i += SHUFFLE_WINDOW) {
+      const uint64_t end = (i + SHUFFLE_WINDOW < added_total) ? i + SHUFFLE_WINDOW : added_total;
+      for (uint64_t j = i; j < end; ++j) {
+        while (added[j].load(std::memory_order_acquire) == NULL) sched_yield();
+      }
+      // Completing the window backward
+      for (uint64_t j = end; j > i; --j) added[j - 1].load()->value.store(0, std::memory_order_release);
+    }
+  });
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([harvesters, &entries, &added, &add_index, t, entry_count]() {
+      harvester_t* harvester = harvesters->Get(hsa_agent_t{t % AGENT_COUNT});
+      for (uint64_t i = 0; i < entry_count; ++i) {
+        entry_t* entry = &entries[t * entry_count + i];
+        harvester->Add(entry);
+        added[add_index.fetch_add(1)].store(entry, std::memory_order_release);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  device.join();
+
+  while (harvest_count.load() != added_total) sched_yield();
+
+  // Stopping a harvester with the entries in flight, the late entries are completed after the stop
+  harvester_t* stopped = new harvester_t;
+  const uint64_t late_half = added_total + LATE_COUNT / 2;
+  for (uint64_t i = added_total; i < late_half; ++i) stopped->Add(&entries[i]);
+  stopped->Stop();
+  for (uint64_t i = late_half; i < total; ++i) stopped->Add(&entries[i]);
+  for (uint64_t i = added_total; i < total; ++i) {
+    if (entries[i].harvested.load() != 0) errors.fetch_add(1);
+    entries[i].value.store(0, std::memory_order_release);
+  }
+  while (harvest_count.load() != total) sched_yield();
+  if (detach_count.load() != LATE_COUNT) errors.fetch_add(1);
+  delete stopped;
+
+  delete harvesters;
+  for (const entry_t& entry : entries) {
+    if (entry.harvested.load() != 1) errors.fetch_add(1);
+  }
+
+  printf("completion harvester test: threads(%u) entries(%lu) harvested(%lu) errors(%lu)\n",
+    thread_count, (unsigned long)total, (unsigned long)harvest_count.load(), (unsigned long)errors.load());
+  return (errors.load() == 0) ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Correlation id map stress test
+//
+// correlation_id_map_test <registering threads> <ids per thread>
+// The registering threads insert unique ids with the value derived from the id,
+// the concurrent lookup thread erases them in the order of the registration.
+// The map is smaller than the total number of ids, so the slots are reused.
+// Then more ids than the map size are registered at once, to use the overflow map.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "core/correlation_id_map.h"
+
+typedef roctracer::CorrelationIdMap<12> map_t;
+map_t correlation_id_map;
+
+// Outstanding ids are limited to a half of the map
+static const uint64_t OUTSTANDING_MAX = map_t::SIZE / 2;
+
+int main(int argc, char** argv) {
+  const uint32_t thread_count = (argc > 1) ? atoi(argv[1]) : 8;
+  const uint64_t id_count = (argc > 2) ? atoll(argv[2]) : 200000;
+  const uint64_t total = thread_count * id_count;
+
+  // Published ids queue, filled by the registering threads after the insert
+  std::vector<std::atomic<uint64_t>> published(total);
+  for (auto& id : published) id.store(0, std::memory_order_relaxed);
+  std::atomic<uint64_t> publish_index{0};
+  std::atomic<uint64_t> lookup_index{0};
+  std::atomic<uint64_t> errors{0};
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&, t]() {
+      for (uint64_t i = 0; i < id_count; ++i) {
+        const uint64_t id = t * id_count + i + 1;
+        while (publish_index.load(std::memory_order_relaxed) >=
+               lookup_index.load(std::memory_order_relaxed) + OUTSTANDING_MAX) sched_yield();
+        if (correlation_id_map.Insert(id, ~id) == false) errors.fetch_add(1);
+        // Duplicate must be rejected while the id is registered
+        if (correlation_id_map.Insert(id, 0) == true) errors.fetch_add(1);
+        published[publish_index.fetch_add(1)].store(id, std::memory_order_release);
+      }
+    });
+  }
+
+  std::thread lookup_thread([&]() {
+    for (uint64_t i = 0; i < total; ++i) {
+      uint64_t id = 0;
+      while ((id = published[i].load(std::memory_order_acquire)) == 0) sched_yield();
+      uint64_t value = 0;
+      if ((correlation_id_map.Lookup(id, &value) == false) || (value != ~id)) errors.fetch_add(1);
+      // The lookup erases the id, a miss scans the tombstones so it is checked sparsely
+      if (((i % 1024) == 0) && (correlation_id_map.Lookup(id, &value) == true)) errors.fetch_add(1);
+      lookup_index.store(i + 1, std::memory_order_relaxed);
+    }
+  });
+
+  for (auto& thread : threads) thread.join();
+  lookup_thread.join();
+
+  // Overflowing the table, all ids must be registered and found
+  const uint64_t overflow_total = map_t::SIZE * 2;
+  for (uint64_t id = total + 1; id <= total + overflow_total; ++id) {
+    if (correlation_id_map.Insert(id, ~id) == false) errors.fetch_add(1);
+  }
+  if (correlation_id_map.OverflowCount() == 0) errors.fetch_add(1);
+  for (uint64_t id = total + 1; id <= total + overflow_total; ++id) {
+    uint64_t value = 0;
+    if ((correlation_id_map.Lookup(id, &value) == false) || (value != ~id)) errors.fetch_add(1);
+  }
+  if (correlation_id_map.OverflowCount() != 0) errors.fetch_add(1);
+
+  printf("threads(%u) ids(%lu) map size(%lu): %lu errors\n",
+    thread_count, (unsigned long)total, (unsigned long)map_t::SIZE, (unsigned long)errors.load());
+  return (errors.load() == 0) ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+////////////////////////////////////////////////////////////////////////////////
+//
+// Interned names table stress test
+//
+// name_table_test <threads> <interns per thread> <distinct names>
+// The threads intern the names from the shared strings, from their own copies and from
+// a reused buffer rewritten with the other names, check the ids are the same for the same
+// name in all threads and demangle the names concurrently.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/name_table.h"
+
+typedef roctracer::util::NameTable table_t;
+
+int main(int argc, char** argv) {
+  const uint32_t thread_count = (argc > 1) ? atoi(argv[1]) : 8;
+  const uint64_t intern_count = (argc > 2) ? atoll(argv[2]) : 200000;
+  const uint32_t name_count = (argc > 3) ? atoi(argv[3]) : 3000;
+
+  std::vector<std::string> names(name_count);
+  for (uint32_t n = 0; n < name_count; ++n) {
+    names[n] = "_Z" + std::to_string(7 + std::to_string(n).size()) + "kernel_" + std::to_string(n) + "Pfi";
+  }
+
+  table_t* table = table_t::Instance();
+  std::vector<std::vector<table_t::id_t>> ids(thread_count, std::vector<table_t::id_t>(name_count));
+  std::vector<std::vector<const char*>> demangled(thread_count, std::vector<const char*>(name_count));
+  std::atomic<uint64_t> errors{0};
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<std::string> copies(names);
+      char buffer[64];
+      for (uint64_t i = 0; i < intern_count; ++i) {
+        const uint32_t n = (i * 7919 + t * 104729) % name_count;
+        table_t::id_t id = 0;
+        switch (i % 3) {
+          case 0: id = table->Intern(names[n].c_str()); break;
+          case 1: id = table->Intern(copies[n].c_str()); break;
+          default:
+            strcpy(buffer, names[n].c_str());
+            id = table->Intern(buffer);
+        }
+        if (strcmp(table->Name(id), names[n].c_str()) != 0) errors.fetch_add(1);
+        ids[t][n] = id;
+      }
+      for (uint32_t n = 0; n < name_count; ++n) {
+        ids[t][n] = table->Intern(names[n].c_str());
+        demangled[t][n] = table->Demangled(ids[t][n]);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  if (table->Count() != name_count) errors.fetch_add(1);
+  for (uint32_t n = 0; n < name_count; ++n) {
+    const std::string expected = "kernel_" + std::to_string(n) + "(float*, int)";
+    if (expected != demangled[0][n]) errors.fetch_add(1);
+    for (uint32_t t = 1; t < thread_count; ++t) {
+      if (ids[t][n] != ids[0][n]) errors.fetch_add(1);
+      if (demangled[t][n] != demangled[0][n]) errors.fetch_add(1);
+    }
+  }
+
+  printf("name table test: threads(%u) interns(%lu) names(%u) interned(%u) errors(%lu)\n",
+    thread_count, (unsigned long)(thread_count * intern_count), name_count, table->Count(),
+    (unsigned long)errors.load());
+  return (errors.load() == 0) ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+/*
+Copyright (c) 2018 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Signal pool stress test
+//
+// signal_pool_test <threads> <signals per thread>
+// The threads acquire bursts of signals from the agent pools, backed by a CPU stand-in
+// of the HSA signal API, check the exclusive ownership and the reset value, complete
+// and release them.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "proxy/signal_pool.h"
+
+struct cpu_signal_t {
+  std::atomic<int64_t> value;
+  std::atomic<uint32_t> owned;
+};
+
+std::atomic<int64_t> signal_count{0};
+
+// CPU stand-in of the HSA signal API
+struct CpuSignalApi {
+  static hsa_status_t Create(hsa_signal_t* signal) {
+    cpu_signal_t* ptr = new cpu_signal_t;
+    ptr->value.store(1, std::memory_order_relaxed);
+    ptr->owned.store(0, std::memory_order_relaxed);
+    signal->handle = reinterpret_cast<uint64_t>(ptr);
+    signal_count.fetch_add(1, std::memory_order_relaxed);
+    return HSA_STATUS_SUCCESS;
+  }
+  static void Reset(const hsa_signal_t& signal) {
+    reinterpret_cast<cpu_signal_t*>(signal.handle)->value.store(1, std::memory_order_relaxed);
+  }
+  static void Destroy(const hsa_signal_t& signal) {
+    delete reinterpret_cast<cpu_signal_t*>(signal.handle);
+    signal_count.fetch_sub(1, std::memory_order_relaxed);
+  }
+};
+
+typedef proxy::AgentSignalPools<CpuSignalApi> pools_t;
+typedef pools_t::pool_t pool_t;
+
+static const uint32_t AGENT_COUNT = 2;
+static const uint32_t BURST_SIZE = 16;
+
+int main(int argc, char** argv) {
+  const uint32_t thread_count = (argc > 1) ? atoi(argv[1]) : 8;
+  const uint64_t signal_count_per_thread = (argc > 2) ? atoll(argv[2]) : 200000;
+  const uint64_t total = thread_count * signal_count_per_thread;
+
+  pools_t* pools = new pools_t;
+  std::atomic<uint64_t> errors{0};
+
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < thread_count; ++t) {
+    threads.emplace_back([pools, t, signal_count_per_thread, &errors]() {
+      hsa_agent_t agent{t % AGENT_COUNT};
+      pool_t* pool = pools->Get(agent);
+      pool_t::index_t index_arr[BURST_SIZE];
+      hsa_signal_t signal_arr[BURST_SIZE];
+      for (uint64_t i = 0; i < signal_count_per_thread; i += BURST_SIZE) {
+        for (uint32_t j = 0; j < BURST_SIZE; ++j) {
+          index_arr[j] = pool->Acquire(&signal_arr[j]);
+          if (index_arr[j] == pool_t::INDEX_NIL) {
+            errors.fetch_add(1);
+            abort();
+          }
+          cpu_signal_t* signal = reinterpret_cast<cpu_signal_t*>(signal_arr[j].handle);
+          if (pool->Signal(index_arr[j]).handle != signal_arr[j].handle) errors.fetch_add(1);
+          if (signal->owned.exchange(1) != 0) errors.fetch_add(1);
+          if (signal->value.load() != 1) errors.fetch_add(1);
+        }
+        for (uint32_t j = 0; j < BURST_SIZE; ++j) {
+          cpu_signal_t* signal = reinterpret_cast<cpu_signal_t*>(signal_arr[j].handle);
+          signal->value.store(0);
+          signal->owned.store(0);
+          pool->Release(index_arr[j]);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  pool_t::stats_t stats{};
+  pools->GetStats(&stats);
+  const uint64_t acquired = thread_count * ((signal_count_per_thread + BURST_SIZE - 1) / BURST_SIZE) * BURST_SIZE;
+  if (stats.hits + stats.misses != acquired) errors.fetch_add(1);
+  if (stats.misses > (uint64_t)thread_count * BURST_SIZE) errors.fetch_add(1);
+  if (signal_count.load() != (int64_t)stats.misses) errors.fetch_add(1);
+  delete pools;
+  if (signal_count.load() != 0) errors.fetch_add(1);
+
+  printf("signal pool test: threads(%u) signals(%lu) hits(%lu) misses(%lu) errors(%lu)\n",
+    thread_count, (unsigned long)total, (unsigned long)stats.hits, (unsigned long)stats.misses,
+    (unsigned long)errors.load());
+  return (errors.load() == 0) ? 0 : 1;
+}
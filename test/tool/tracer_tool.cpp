@@ -23,9 +23,9 @@ THE SOFTWARE.
 #include <sstream>
 #include <string>
 
-#include <cxxabi.h>  /* names denangle */
 #include <dirent.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/syscall.h>  /* SYS_xxx definitions */
@@ -43,6 +43,7 @@ THE SOFTWARE.
 #include <inc/ext/hsa_rt_utils.hpp>
 #include <src/core/loader.h>
 #include <src/core/trace_buffer.h>
+#include <src/util/name_table.h>
 #include <util/xml.h>
 
 #define PUBLIC_API __attribute__((visibility("default")))
@@ -102,14 +103,6 @@ void fatal(const std::string msg) {
   abort();
 }
 
-// C++ symbol demangle
-static inline const char* cxx_demangle(const char* symbol) {
-  size_t funcnamesize;
-  int status;
-  const char* ret = (symbol != NULL) ? abi::__cxa_demangle(symbol, NULL, &funcnamesize, &status) : symbol;
-  return (ret != NULL) ? ret : symbol;
-}
-
 // Tracing control thread
 uint32_t control_delay_us = 0;
 uint32_t control_len_us = 0;
@@ -144,19 +137,10 @@ void* control_thr_fun(void*) {
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 // rocTX annotation tracing
 
-struct roctx_trace_entry_t {
-  uint32_t valid;
-  uint32_t type;
-  uint32_t cid;
-  timestamp_t timestamp;
-  uint32_t pid;
-  uint32_t tid;
-  const char* message;
-};
-
-void roctx_flush_cb(roctx_trace_entry_t* entry);
-roctracer::TraceBuffer<roctx_trace_entry_t>::flush_prm_t roctx_flush_prm[1] = {{0, roctx_flush_cb}};
-roctracer::TraceBuffer<roctx_trace_entry_t> roctx_trace_buffer("rocTX API", 0x200000, roctx_flush_prm, 1);
+// rocTX records pool, the messages are copied inline to the records.
+// The callbacks in flight are counted, the pool is closed when they are drained.
+std::atomic<roctracer_pool_t*> roctx_pool{NULL};
+std::atomic<uint32_t> roctx_writers{0};
 
 // rocTX callback function
 static inline void roctx_callback_fun(
@@ -165,15 +149,21 @@ static inline void roctx_callback_fun(
     uint32_t tid,
     const char* message)
 {
-  const timestamp_t timestamp = timer->timestamp_fn_ns();
-  roctx_trace_entry_t* entry = roctx_trace_buffer.GetEntry();
-  entry->valid = roctracer::TRACE_ENTRY_COMPL;
-  entry->type = 0;
-  entry->cid = cid;
-  entry->timestamp = timestamp;
-  entry->pid = GetPid();
-  entry->tid = tid;
-  entry->message = (message != NULL) ? strdup(message) : NULL;
+  roctx_writers.fetch_add(1);
+  roctracer_pool_t* pool = roctx_pool.load();
+  if (pool == NULL) {
+    roctx_writers.fetch_sub(1, std::memory_order_release);
+    return;
+  }
+  roctracer_record_t record{};
+  record.domain = domain;
+  record.op = cid;
+  record.begin_ns = timer->timestamp_fn_ns();
+  record.process_id = GetPid();
+  record.thread_id = tid;
+  const uint32_t size = (message != NULL) ? strlen(message) + 1 : 0;
+  ROCTRACER_CALL(roctracer_write_record(&record, message, size, pool));
+  roctx_writers.fetch_sub(1, std::memory_order_release);
 }
 
 void roctx_api_callback(
@@ -203,19 +193,29 @@ void start_callback() {
   roctracer::RocTxLoader::Instance().RangeStackIterate(roctx_range_stack_callback, (void*)&is_stop);
 }
 
-void roctx_flush_cb(roctx_trace_entry_t* entry) {
-  std::ostringstream os;
-  os << entry->timestamp << " " << entry->pid << ":" << entry->tid << " " << entry->cid;
-  if (entry->message != NULL) os << ":\"" << entry->message << "\"";
-  else os << ":\"\"";
-  fprintf(roctx_file_handle, "%s\n", os.str().c_str()); fflush(roctx_file_handle);
+// rocTX records pool callback
+void roctx_activity_callback(const char* begin, const char* end, void* arg) {
+  const roctracer_record_header_t* header = reinterpret_cast<const roctracer_record_header_t*>(begin);
+  const roctracer_record_header_t* end_header = reinterpret_cast<const roctracer_record_header_t*>(end);
+
+  while (header < end_header) {
+    const roctracer_record_t* record = roctracer_record_data(header);
+    const char* message = reinterpret_cast<const char*>(roctracer_record_payload(header));
+    std::ostringstream os;
+    os << record->begin_ns << " " << record->process_id << ":" << record->thread_id << " " << record->op;
+    if (message != NULL) os << ":\"" << message << "\"";
+    else os << ":\"\"";
+    fprintf(roctx_file_handle, "%s\n", os.str().c_str());
+    ROCTRACER_CALL(roctracer_next_var_record(header, &header));
+  }
+  fflush(roctx_file_handle);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 // HSA API tracing
 
 struct hsa_api_trace_entry_t {
-  uint32_t valid;
+  roctracer::trace_state_t valid;
   uint32_t type;
   uint32_t cid;
   timestamp_t begin;
@@ -243,7 +243,6 @@ void hsa_api_callback(
   } else {
     const timestamp_t end_timestamp = (cid == HSA_API_ID_hsa_shut_down) ? hsa_begin_timestamp : timer->timestamp_fn_ns();
     hsa_api_trace_entry_t* entry = hsa_api_trace_buffer.GetEntry();
-    entry->valid = roctracer::TRACE_ENTRY_COMPL;
     entry->type = 0;
     entry->cid = cid;
     entry->begin = hsa_begin_timestamp;
@@ -251,6 +250,7 @@ void hsa_api_callback(
     entry->pid = GetPid();
     entry->tid = GetTid();
     entry->data = *data;
+    entry->valid.store(roctracer::TRACE_ENTRY_COMPL, std::memory_order_release);
   }
 }
 
@@ -271,7 +271,7 @@ void hsa_activity_callback(
 }
 
 struct hip_api_trace_entry_t {
-  uint32_t valid;
+  roctracer::trace_state_t valid;
   uint32_t type;
   uint32_t domain;
   uint32_t cid;
@@ -280,10 +280,13 @@ struct hip_api_trace_entry_t {
   uint32_t pid;
   uint32_t tid;
   hip_api_data_t data;
-  const char* name;
+  uint32_t name_id;                                    // interned kernel or marker name id
   void* ptr;
 };
 
+// No interned name
+static const uint32_t NAME_ID_NONE = UINT32_MAX;
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////
 // HIP API tracing
 
@@ -305,7 +308,6 @@ void hip_api_callback(
   } else {
     const timestamp_t end_timestamp = timer->timestamp_fn_ns();
     hip_api_trace_entry_t* entry = hip_api_trace_buffer.GetEntry();
-    entry->valid = roctracer::TRACE_ENTRY_COMPL;
     entry->type = 0;
     entry->cid = cid;
     entry->domain = domain;
@@ -314,7 +316,7 @@ void hip_api_callback(
     entry->pid = GetPid();
     entry->tid = GetTid();
     entry->data = *data;
-    entry->name = NULL;
+    entry->name_id = NAME_ID_NONE;
     entry->ptr = NULL;
 
     switch (cid) {
@@ -328,9 +330,10 @@ void hip_api_callback(
 #endif
         const hipFunction_t f = data->args.hipModuleLaunchKernel.f;
         if (f != NULL) {
-          entry->name = strdup(roctracer::HipLoader::Instance().KernelNameRef(f));
+          entry->name_id = roctracer::util::NameTable::Instance()->Intern(roctracer::HipLoader::Instance().KernelNameRef(f));
         }
     }
+    entry->valid.store(roctracer::TRACE_ENTRY_COMPL, std::memory_order_release);
   }
 }
 
@@ -345,7 +348,6 @@ void mark_api_callback(
 
   const timestamp_t timestamp = timer->timestamp_fn_ns();
   hip_api_trace_entry_t* entry = hip_api_trace_buffer.GetEntry();
-  entry->valid = roctracer::TRACE_ENTRY_COMPL;
   entry->type = 0;
   entry->cid = 0;
   entry->domain = domain;
@@ -354,8 +356,9 @@ void mark_api_callback(
   entry->pid = GetPid();
   entry->tid = GetTid();
   entry->data = {};
-  entry->name = strdup(name);
+  entry->name_id = (name != NULL) ? roctracer::util::NameTable::Instance()->Intern(name) : NAME_ID_NONE;
   entry->ptr = NULL;
+  entry->valid.store(roctracer::TRACE_ENTRY_COMPL, std::memory_order_release);
 }
 
 void hip_api_flush_cb(hip_api_trace_entry_t* entry) {
@@ -398,14 +401,15 @@ void hip_api_flush_cb(hip_api_trace_entry_t* entry) {
 #endif
         fprintf(hip_api_file_handle, "%s(kernel(%s) stream(%p))\n",
           oss.str().c_str(),
-          cxx_demangle(entry->name),
+          (entry->name_id != NAME_ID_NONE) ? roctracer::util::NameTable::Instance()->Demangled(entry->name_id) : NULL,
           data->args.hipModuleLaunchKernel.stream);
         break;
       default:
         fprintf(hip_api_file_handle, "%s()\n", oss.str().c_str());
     }
   } else {
-    fprintf(hip_api_file_handle, "%s(name(%s))\n", oss.str().c_str(), entry->name);
+    const char* name = (entry->name_id != NAME_ID_NONE) ? roctracer::util::NameTable::Instance()->Name(entry->name_id) : NULL;
+    fprintf(hip_api_file_handle, "%s(name(%s))\n", oss.str().c_str(), name);
   }
 
   fflush(hip_api_file_handle);
@@ -637,6 +641,16 @@ extern "C" PUBLIC_API bool OnLoad(HsaApiTable* table, uint64_t runtime_version,
   if (trace_roctx) {
     roctx_file_handle = open_output_file(output_prefix, "roctx_trace.txt");
 
+    // rocTX records pool
+    roctracer_properties_t roctx_properties{};
+    roctx_properties.mode = ROCTRACER_POOL_MODE_VAR_RECORDS;
+    roctx_properties.buffer_size = 0x80000;
+    roctx_properties.buffer_callback_fun = roctx_activity_callback;
+    roctx_properties.drain_timeout = UINT32_MAX;
+    roctracer_pool_t* pool = NULL;
+    ROCTRACER_CALL(roctracer_open_pool(&roctx_properties, &pool));
+    roctx_pool.store(pool);
+
     // initialize HSA tracing
     roctracer_ext_properties_t properties {
       start_callback,
@@ -699,6 +713,15 @@ extern "C" PUBLIC_API bool OnLoad(HsaApiTable* table, uint64_t runtime_version,
     roctracer_properties_t properties{};
     properties.buffer_size = 0x80000;
     properties.buffer_callback_fun = hcc_activity_callback;
+    properties.drain_timeout = UINT32_MAX;
+    // Flight recorder mode, the activity records are dumped on the given signal and at exit
+    const char* recorder_str = getenv("ROCP_FLIGHT_RECORDER");
+    if (recorder_str != NULL) {
+      properties.mode = ROCTRACER_POOL_MODE_FLIGHT_RECORDER;
+      properties.buffer_count = 8;
+      properties.dump_signal = atoi(recorder_str);
+      fprintf(stdout, "ROCTracer: flight recorder, dump signal(%d)\n", properties.dump_signal); fflush(stdout);
+    }
     ROCTRACER_CALL(roctracer_open_pool(&properties));
     if (trace_hip_api) {
       ROCTRACER_CALL(roctracer_enable_domain_callback(ACTIVITY_DOMAIN_HIP_API, hip_api_callback, NULL));
@@ -778,7 +801,11 @@ void tool_unload(bool destruct) {
   if (trace_roctx) {
     ROCTRACER_CALL(roctracer_disable_domain_callback(ACTIVITY_DOMAIN_ROCTX));
 
-    roctx_trace_buffer.Flush();
+    // The pool is reset before the writers are counted, both in seq_cst order, so a callback
+    // either sees no pool or is waited for
+    roctracer_pool_t* pool = roctx_pool.exchange(NULL);
+    while (roctx_writers.load() != 0) sched_yield();
+    ROCTRACER_CALL(roctracer_close_pool(pool));
     close_output_file(roctx_file_handle);
   }
   if (trace_hsa_api) {
@@ -799,6 +826,7 @@ void tool_unload(bool destruct) {
     ROCTRACER_CALL(roctracer_flush_activity());
     ROCTRACER_CALL(roctracer_close_pool());
 
+    roctracer::util::NameTable::Instance()->DemangleAll();
     hip_api_trace_buffer.Flush();
     close_output_file(hip_api_file_handle);
     close_output_file(hcc_activity_file_handle);